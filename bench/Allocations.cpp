@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+// The global allocation functions of the bench, counting every allocation
+// for the allocations/op and bytes/op of the results
+namespace
+{
+    std::atomic<std::size_t> count{ 0 };
+    std::atomic<std::size_t> bytes{ 0 };
+
+    void* allocate(std::size_t size)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        if (auto* p = std::malloc(size == 0 ? 1 : size))
+            return p;
+        throw std::bad_alloc();
+    }
+
+    void* allocate(std::size_t size, std::align_val_t alignment)
+    {
+        count.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(size, std::memory_order_relaxed);
+        const auto align = static_cast<std::size_t>(alignment);
+        // aligned_alloc wants a multiple of the alignment
+        const auto rounded = (size + align - 1) / align * align;
+#if defined(_MSC_VER)
+        auto* p = _aligned_malloc(rounded == 0 ? align : rounded, align);
+#else
+        auto* p = std::aligned_alloc(align, rounded == 0 ? align : rounded);
+#endif
+        if (p)
+            return p;
+        throw std::bad_alloc();
+    }
+
+    void release(void* p, std::align_val_t)
+    {
+#if defined(_MSC_VER)
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+}
+
+
+std::size_t bench::allocationCount()
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+
+std::size_t bench::allocatedBytes()
+{
+    return bytes.load(std::memory_order_relaxed);
+}
+
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, alignment); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t alignment) noexcept { release(p, alignment); }
+void operator delete[](void* p, std::align_val_t alignment) noexcept { release(p, alignment); }
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept { release(p, alignment); }
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept { release(p, alignment); }
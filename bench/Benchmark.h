@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+
+
+// Minimal benchmark harness: runs a callable repeatedly until a time budget is
+// used up and reports the average time of one call, with the heap
+// allocations and bytes it made (counted by the operator new of the bench,
+// see Allocations.cpp). writeJson() saves all the results for comparing runs.
+namespace bench
+{
+    // heap allocations and allocated bytes since the start of the program
+    std::size_t allocationCount();
+    std::size_t allocatedBytes();
+
+    struct Counter
+    {
+        std::string name;
+        double value;
+        std::string unit;
+    };
+
+    struct Result
+    {
+        std::string name;
+        double nsPerOp;
+        double bytesPerOp;
+        double allocationsPerOp;
+        std::vector<Counter> counters;
+    };
+
+    // Prevents the optimizer from removing a computation whose result is unused
+    template <typename V>
+    void doNotOptimize(const V& value)
+    {
+        // a volatile store: never read, but it cannot be removed
+        [[maybe_unused]] static const void* volatile sink;
+        sink = &value;
+    }
+
+    class Runner
+    {
+    public:
+        // only benchmarks whose name contains filter are run
+        explicit Runner(std::ostream& ostr, const std::string& filter = "", double minSeconds = 0.2)
+            : m_ostr(ostr), m_filter(filter), m_minSeconds(minSeconds) {}
+
+        // Runs f() until at least m_minSeconds have passed, prints and returns ns per call
+        template <typename F>
+        double run(const std::string& name, F&& f)
+        {
+            m_skipped = name.find(m_filter) == std::string::npos;
+            if (m_skipped)
+                return 0;
+
+            using Clock = std::chrono::steady_clock;
+            f(); // warm up caches and the allocator
+
+            long long iterations = 0;
+            auto batch = 1LL;
+            const auto allocations = allocationCount();
+            const auto bytes = allocatedBytes();
+            const auto start = Clock::now();
+            auto elapsed = 0.0;
+            while (elapsed < m_minSeconds)
+            {
+                for (long long i = 0; i < batch; ++i)
+                    f();
+                iterations += batch;
+                batch *= 2;
+                elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+            }
+
+            const auto perOp = [&](std::size_t count) { return static_cast<double>(count) / static_cast<double>(iterations); };
+            const auto result = Result{ name, elapsed * 1e9 / static_cast<double>(iterations),
+                perOp(allocatedBytes() - bytes), perOp(allocationCount() - allocations), {} };
+            m_ostr << std::left << std::setw(48) << name << std::right << std::setw(16)
+                << std::fixed << std::setprecision(1) << result.nsPerOp << " ns/op"
+                << std::setw(14) << std::setprecision(0) << result.bytesPerOp << " B/op"
+                << std::setw(10) << std::setprecision(1) << result.allocationsPerOp << " allocs/op\n";
+            m_results.push_back(result);
+            return result.nsPerOp;
+        }
+
+        // Prints a derived figure (e.g. GFLOP/s) under the last benchmark
+        void counter(const std::string& name, double value, const std::string& unit)
+        {
+            if (m_skipped)
+                return;
+            m_ostr << std::left << std::setw(48) << ("  " + name) << std::right << std::setw(16)
+                << std::fixed << std::setprecision(2) << value << ' ' << unit << '\n';
+            if (!m_results.empty())
+                m_results.back().counters.push_back(Counter{ name, value, unit });
+        }
+
+        const std::vector<Result>& results() const { return m_results; }
+
+        // {"context": {...}, "benchmarks": [{"name", "ns_per_op", "bytes_per_op",
+        // "allocations_per_op", "counters": [{"name", "value", "unit"}]}]}
+        void writeJson(std::ostream& ostr) const;
+
+    private:
+        std::ostream& m_ostr;
+        std::string m_filter;
+        double m_minSeconds;
+        bool m_skipped = false;
+        std::vector<Result> m_results;
+    };
+
+    void runStorageBenchmarks(Runner& runner);
+    void runMulBenchmarks(Runner& runner);
+    void runElementwiseBenchmarks(Runner& runner);
+    void runFusionBenchmarks(Runner& runner);
+    void runProgramBenchmarks(Runner& runner);
+    void runTransposeBenchmarks(Runner& runner);
+    void runTableBenchmarks(Runner& runner);
+    void runPolicyBenchmarks(Runner& runner);
+    void runFixedBenchmarks(Runner& runner);
+    void runFileBenchmarks(Runner& runner);
+    void runParserBenchmarks(Runner& runner);
+    void runScriptBenchmarks(Runner& runner);
+    void runFormatBenchmarks(Runner& runner);
+    void runElementTypeBenchmarks(Runner& runner);
+    void runSparseBenchmarks(Runner& runner);
+    void runPowerBenchmarks(Runner& runner);
+    void runLuBenchmarks(Runner& runner);
+}
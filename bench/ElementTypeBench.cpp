@@ -0,0 +1,81 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "MatrixKernels.h"
+#include "SimdKernels.h"
+#include "ElementType.h"
+#include "Add.h"
+#include "Mul.h"
+#include "Scalar.h"
+#include "Transpose.h"
+#include "Identity.h"
+#include "OperationPool.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // values small enough for every product of the benchmarks to stay in range
+    template <typename E>
+    SquareMatrix<E> makeMatrix(int size, int seed)
+    {
+        auto matrix = SquareMatrix<E>(size, E());
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+        {
+            if constexpr (std::is_integral_v<E>)
+                matrix.data()[i] = static_cast<E>((i + static_cast<std::size_t>(seed)) % 3) - 1;
+            else
+                matrix.data()[i] = static_cast<E>(static_cast<int>((i + static_cast<std::size_t>(seed)) % 7) - 3) / E(8);
+        }
+        return matrix;
+    }
+
+    template <typename E>
+    void runType(bench::Runner& runner, const Operation& tree)
+    {
+        using bench::doNotOptimize;
+        const auto name = std::string("types/") + elementTypeName(elementTypeOf<E>());
+
+        for (const int size : { 64, 256 })
+        {
+            const auto suffix = "/" + std::to_string(size);
+            const auto lhs = makeMatrix<E>(size, 0);
+            const auto rhs = makeMatrix<E>(size, 1);
+
+            runner.run(name + "/add" + suffix, [&] { doNotOptimize(SquareMatrix<E>(lhs + rhs)); });
+            runner.run(name + "/scale" + suffix, [&] { doNotOptimize(SquareMatrix<E>(lhs * E(3))); });
+            const auto ns = runner.run(name + "/mul" + suffix, [&] { doNotOptimize(lhs * rhs); });
+            runner.counter("GFLOP/s", 2.0 * size * size * size / ns, "GFLOP/s");
+
+            // the generic loops the dispatched kernels replace
+            if constexpr (std::is_floating_point_v<E>)
+            {
+                auto c = std::vector<E>(lhs.count());
+                const auto generic = runner.run(name + "/gemm-generic" + suffix, [&] { kernels::gemm(size, lhs.data(), rhs.data(), c.data()); doNotOptimize(c); });
+                runner.counter("GFLOP/s", 2.0 * size * size * size / generic, "GFLOP/s");
+            }
+
+            // a whole eval of the same compiled operation
+            auto input = std::vector<SquareMatrix<E>>();
+            for (int i = 0; i < tree.inputCount(); ++i)
+                input.push_back(i % 2 == 0 ? lhs : rhs);
+            runner.run(name + "/program" + suffix, [&] { doNotOptimize(tree.program().run(input)); });
+        }
+    }
+}
+
+
+void bench::runElementTypeBenchmarks(Runner& runner)
+{
+    // (scal 2 + tran) * id: one compiled program, run on every element type
+    auto pool = OperationPool(false);
+    const auto sum = pool.combine<Add>(pool.emplace<Scalar>(2), pool.emplace<Transpose>());
+    const auto tree = pool.combine<Mul>(sum, pool.emplace<Identity>());
+
+    runType<int>(runner, pool[tree]);
+    runType<std::int64_t>(runner, pool[tree]);
+    runType<float>(runner, pool[tree]);
+    runType<double>(runner, pool[tree]);
+}
@@ -0,0 +1,54 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "SimdKernels.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // The loop SquareMatrix::operator+ used before the SIMD kernels
+    void checkedAddLoop(const SquareMatrix<int>& a, const SquareMatrix<int>& b, SquareMatrix<int>& out)
+    {
+        for (std::size_t i = 0; i < a.count(); ++i)
+        {
+            const int sum = a.data()[i] + b.data()[i];
+            a.checkVal(sum);
+            out.data()[i] = sum;
+        }
+    }
+
+    SquareMatrix<int> makeMatrix(int size)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>(i % 61) - 30;
+        return matrix;
+    }
+}
+
+
+void bench::runElementwiseBenchmarks(Runner& runner)
+{
+    runner.counter("simd level: " + std::string(kernels::simdLevel()), 0, "");
+    for (const int size : { 16, 256, 1024, 2048 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        const auto bytes = 3.0 * size * size * sizeof(int);
+
+        const auto a = makeMatrix(size);
+        const auto b = makeMatrix(size);
+        auto out = SquareMatrix<int>(size, 0);
+
+        const auto loop = runner.run("elementwise/add-checkVal-loop" + suffix, [&] { checkedAddLoop(a, b, out); doNotOptimize(out); });
+        runner.counter("bandwidth", bytes / loop, "GB/s");
+        const auto kernel = runner.run("elementwise/add-kernel" + suffix, [&] {
+            doNotOptimize(kernels::addInRange(a.data(), b.data(), out.data(), out.count(), MIN_ALLOWED_VALU, MAX_ALLOWED_VALUE));
+        });
+        runner.counter("bandwidth", bytes / kernel, "GB/s");
+        runner.run("elementwise/add" + suffix, [&] { doNotOptimize(SquareMatrix<int>(a + b)); });
+        runner.run("elementwise/sub" + suffix, [&] { doNotOptimize(SquareMatrix<int>(a - b)); });
+        runner.run("elementwise/scale" + suffix, [&] { doNotOptimize(SquareMatrix<int>(a * 3)); });
+    }
+}
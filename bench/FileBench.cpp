@@ -0,0 +1,76 @@
+#include "Benchmark.h"
+#include "MatrixFile.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+void bench::runFileBenchmarks(Runner& runner)
+{
+    const auto directory = std::filesystem::temp_directory_path();
+    for (const int size : { 4, 64, 512 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        // about 16 MiB of int values per file
+        const auto count = std::max<std::size_t>(1, (std::size_t(16) << 20) / (sizeof(int) * std::size_t(size) * std::size_t(size)));
+
+        const auto textPath = (directory / ("oop2_bench_" + std::to_string(size) + ".txt")).string();
+        const auto binaryPath = (directory / ("oop2_bench_" + std::to_string(size) + MATRIX_FILE_EXTENSION)).string();
+        {
+            auto text = std::ofstream(textPath);
+            auto matrix = SquareMatrix<int>(size, 0);
+            for (std::size_t i = 0; i < matrix.count(); ++i)
+                matrix.data()[i] = static_cast<int>(i % 2001) - 1000;
+            for (std::size_t k = 0; k < count; ++k)
+                text << matrix << '\n';
+        }
+        {
+            auto text = std::ifstream(textPath);
+            MatrixFile::fromText(text, size, binaryPath);
+        }
+        const auto megabytes = static_cast<double>(count * std::size_t(size) * std::size_t(size) * sizeof(int)) / 1e6;
+        const auto report = [&](const std::string& name, double ns) {
+            runner.counter(name + "/throughput", megabytes * 1e9 / ns, "MB/s");
+        };
+
+        // the way beval reads a text file: operator>> per value
+        auto name = "file/text-parse" + suffix;
+        report(name, runner.run(name, [&] {
+            auto text = std::ifstream(textPath);
+            auto matrix = SquareMatrix<int>(size, 0);
+            long long sum = 0;
+            for (std::size_t k = 0; k < count; ++k)
+            {
+                text >> matrix;
+                sum += matrix.data()[0];
+            }
+            doNotOptimize(sum);
+        }));
+
+        // mapping the matrix file and reading every value through the views
+        name = "file/mapped-load" + suffix;
+        report(name, runner.run(name, [&] {
+            const auto file = MatrixFile(binaryPath);
+            long long sum = 0;
+            for (std::size_t k = 0; k < file.count(); ++k)
+            {
+                const auto view = file.view(k);
+                for (std::size_t i = 0; i < view.count(); ++i)
+                    sum += view.data()[i];
+            }
+            doNotOptimize(sum);
+        }));
+
+        name = "file/convert" + suffix;
+        report(name, runner.run(name, [&] {
+            auto text = std::ifstream(textPath);
+            doNotOptimize(MatrixFile::fromText(text, size, binaryPath));
+        }));
+
+        std::filesystem::remove(textPath);
+        std::filesystem::remove(binaryPath);
+    }
+}
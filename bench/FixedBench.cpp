@@ -0,0 +1,57 @@
+#include "Benchmark.h"
+#include "FixedSquareMatrix.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Mul.h"
+#include "Scalar.h"
+#include "Transpose.h"
+#include "Identity.h"
+#include "OperationPool.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    template <int N>
+    void runFixed(bench::Runner& runner)
+    {
+        using bench::doNotOptimize;
+        const auto suffix = "/" + std::to_string(N);
+
+        auto lhs = SquareMatrix<int>(N, 0);
+        auto rhs = SquareMatrix<int>(N, 0);
+        for (std::size_t i = 0; i < lhs.count(); ++i)
+        {
+            lhs.data()[i] = static_cast<int>(i % 7) - 3;
+            rhs.data()[i] = static_cast<int>(i % 5) - 2;
+        }
+        const auto fixedLhs = FixedSquareMatrix<int, N>(lhs);
+        const auto fixedRhs = FixedSquareMatrix<int, N>(rhs);
+
+        runner.run("fixed/add/dynamic" + suffix, [&] { doNotOptimize(SquareMatrix<int>(lhs + rhs)); });
+        runner.run("fixed/add/fixed" + suffix, [&] { doNotOptimize(fixedLhs + fixedRhs); });
+        runner.run("fixed/mul/dynamic" + suffix, [&] { doNotOptimize(lhs * rhs); });
+        runner.run("fixed/mul/fixed" + suffix, [&] { doNotOptimize(fixedLhs * fixedRhs); });
+        runner.run("fixed/transpose/dynamic" + suffix, [&] { doNotOptimize(lhs.Transpose()); });
+        runner.run("fixed/transpose/fixed" + suffix, [&] { doNotOptimize(fixedLhs.Transpose()); });
+
+        // a whole eval: (id + tran) * (scal 2) - id, by the tree walk on
+        // SquareMatrix and by the program, which runs on FixedSquareMatrix
+        auto pool = OperationPool();
+        const auto sum = pool.combine<Add>(pool.emplace<Identity>(), pool.emplace<Transpose>());
+        const auto& op = pool[pool.combine<Sub>(pool.combine<Mul>(sum, pool.emplace<Scalar>(2)), pool.emplace<Identity>())];
+        const auto input = std::vector<SquareMatrix<int>>(static_cast<std::size_t>(op.inputCount()), lhs);
+        runner.run("fixed/eval/recursive" + suffix, [&] { doNotOptimize(op.compute(input)); });
+        runner.run("fixed/eval/compiled" + suffix, [&] { doNotOptimize(op.program().run(input)); });
+    }
+}
+
+
+void bench::runFixedBenchmarks(Runner& runner)
+{
+    runFixed<2>(runner);
+    runFixed<3>(runner);
+    runFixed<4>(runner);
+}
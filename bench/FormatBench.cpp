@@ -0,0 +1,61 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+
+namespace
+{
+    // counts what is written and drops it, so only the formatting is timed
+    class CountingBuffer : public std::streambuf
+    {
+    public:
+        std::size_t written = 0;
+
+    protected:
+        int_type overflow(int_type ch) override { ++written; return traits_type::not_eof(ch); }
+        std::streamsize xsputn(const char*, std::streamsize count) override { written += static_cast<std::size_t>(count); return count; }
+    };
+
+    // The previous operator<<: a formatted write per value and separator
+    void formattedWrite(std::ostream& ostr, const SquareMatrix<int>& matrix)
+    {
+        for (int i = 0; i < matrix.size(); ++i)
+        {
+            const int* row = matrix.row(i);
+            for (int j = 0; j < matrix.size(); ++j)
+                ostr << row[j] << ' ';
+            ostr << '\n';
+        }
+    }
+}
+
+
+void bench::runFormatBenchmarks(Runner& runner)
+{
+    for (const int size : { 4, 256, 1024 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>(i * 37 % 2047) - 1023;
+
+        auto buffer = CountingBuffer();
+        auto ostr = std::ostream(&buffer);
+        const auto report = [&](const std::string& name, double ns, std::size_t bytes) {
+            runner.counter(name + "/throughput", static_cast<double>(bytes) / ns * 1e3, "MB/s");
+        };
+
+        buffer.written = 0;
+        formattedWrite(ostr, matrix);
+        const auto bytes = buffer.written;
+
+        auto name = "format/per-value" + suffix;
+        report(name, runner.run(name, [&] { formattedWrite(ostr, matrix); }), bytes);
+
+        name = "format/to_chars" + suffix;
+        report(name, runner.run(name, [&] { ostr << matrix; }), bytes);
+    }
+}
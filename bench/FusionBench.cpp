@@ -0,0 +1,52 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Scalar.h"
+#include "Transpose.h"
+#include "Identity.h"
+#include "OperationPool.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    SquareMatrix<int> makeMatrix(int size, int seed)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>((i + static_cast<std::size_t>(seed)) % 41) - 20;
+        return matrix;
+    }
+}
+
+
+void bench::runFusionBenchmarks(Runner& runner)
+{
+    // (scal 3 + tran) - id
+    auto pool = OperationPool();
+    const auto& tree = pool[pool.combine<Sub>(
+        pool.combine<Add>(pool.emplace<Scalar>(3), pool.emplace<Transpose>()),
+        pool.emplace<Identity>())];
+
+    for (const int size : { 64, 512, 2048 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        const auto input = std::vector{ makeMatrix(size, 0), makeMatrix(size, 1), makeMatrix(size, 2) };
+
+        // one full pass and one temporary per node, as before the expressions
+        runner.run("fusion/eager" + suffix, [&] {
+            const auto scaled = SquareMatrix<int>::scale(input[0], 3);
+            const auto transposed = input[1].Transpose();
+            const auto sum = SquareMatrix<int>::add(scaled, transposed);
+            const auto identity = input[2];
+            doNotOptimize(SquareMatrix<int>::sub(sum, identity));
+        });
+        runner.run("fusion/expression" + suffix, [&] {
+            doNotOptimize(SquareMatrix<int>(input[0] * 3 + MatrixTerm<int>(input[1], true) - input[2]));
+        });
+        runner.run("fusion/operation-tree" + suffix, [&] { doNotOptimize(tree.compute(input)); });
+    }
+}
@@ -0,0 +1,47 @@
+#include "Benchmark.h"
+#include "SimdKernels.h"
+#include "ThreadPool.h"
+
+#include <ostream>
+
+
+namespace
+{
+    std::string quoted(const std::string& text)
+    {
+        auto result = std::string("\"");
+        for (const auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result + '"';
+    }
+}
+
+
+void bench::Runner::writeJson(std::ostream& ostr) const
+{
+    ostr << std::setprecision(17) << std::defaultfloat;
+    ostr << "{\n  \"context\": {\"simd\": " << quoted(kernels::simdLevel())
+        << ", \"threads\": " << ThreadPool::defaultWorkerCount()
+        << ", \"filter\": " << quoted(m_filter) << "},\n  \"benchmarks\": [";
+    for (std::size_t i = 0; i < m_results.size(); ++i)
+    {
+        const auto& result = m_results[i];
+        ostr << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << quoted(result.name)
+            << ", \"ns_per_op\": " << result.nsPerOp
+            << ", \"bytes_per_op\": " << result.bytesPerOp
+            << ", \"allocations_per_op\": " << result.allocationsPerOp
+            << ", \"counters\": [";
+        for (std::size_t k = 0; k < result.counters.size(); ++k)
+        {
+            const auto& counter = result.counters[k];
+            ostr << (k == 0 ? "" : ", ") << "{\"name\": " << quoted(counter.name)
+                << ", \"value\": " << counter.value << ", \"unit\": " << quoted(counter.unit) << "}";
+        }
+        ostr << "]}";
+    }
+    ostr << "\n  ]\n}\n";
+}
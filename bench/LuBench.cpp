@@ -0,0 +1,71 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "LuFactorization.h"
+#include "EvalCache.h"
+#include "Identity.h"
+#include "Det.h"
+#include "Inverse.h"
+#include "Solve.h"
+#include "Add.h"
+#include "OperationPool.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // diagonally dominant, so that it is well conditioned and det fits the window
+    SquareMatrix<double> makeMatrix(int size)
+    {
+        auto matrix = SquareMatrix<double>(size, 0.0);
+        for (int i = 0; i < size; ++i)
+        {
+            for (int j = 0; j < size; ++j)
+                matrix(i, j) = ((i * 7 + j * 13) % 17 - 8) / (8.0 * size);
+            matrix(i, i) = 1.0;
+        }
+        return matrix;
+    }
+}
+
+
+void bench::runLuBenchmarks(Runner& runner)
+{
+    for (const int size : { 64, 256, 512 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        const auto matrix = makeMatrix(size);
+        const auto flops = 2.0 * size * size * size / 3.0;
+
+        auto ns = runner.run("lu/factor/unblocked" + suffix, [&] { doNotOptimize(LuFactorization<double>(matrix, size)); });
+        runner.counter("GFLOP/s", flops / ns, "");
+        ns = runner.run("lu/factor/blocked" + suffix, [&] { doNotOptimize(LuFactorization<double>(matrix)); });
+        runner.counter("GFLOP/s", flops / ns, "");
+
+        const auto factorization = LuFactorization<double>(matrix);
+        runner.run("lu/det" + suffix, [&] { doNotOptimize(factorization.determinant()); });
+        runner.run("lu/inverse" + suffix, [&] { doNotOptimize(factorization.inverse()); });
+        runner.run("lu/solve" + suffix, [&] { doNotOptimize(factorization.solve(matrix)); });
+    }
+
+    // exact factorization of a small integral matrix
+    auto exact = SquareMatrix<int>(8, 0);
+    for (int i = 0; i < exact.size(); ++i)
+        for (int j = 0; j < exact.size(); ++j)
+            exact(i, j) = i == j ? 4 : (i + j) % 3 - 1;
+    runner.run("lu/factor/exact/8", [&] { doNotOptimize(LuFactorization<int>(exact)); });
+
+    // det A + inv A + A \ A on one matrix: one factorization with a cache,
+    // three without
+    constexpr int size = 128;
+    auto pool = OperationPool(false);
+    const auto identity = pool.emplace<Identity>();
+    const auto sum = pool.combine<Add>(pool.apply<Det>(identity), pool.apply<Inverse>(identity));
+    const auto& tree = pool[pool.combine<Add>(sum, pool.combine<Solve>(identity, identity))];
+    const auto input = std::vector<SquareMatrix<double>>(static_cast<std::size_t>(tree.inputCount()), makeMatrix(size));
+    auto cache = EvalCache();
+    const auto name = "lu/program/det+inv+solve/" + std::to_string(size);
+    runner.run(name + "/computed", [&] { doNotOptimize(tree.program().run(input)); });
+    runner.run(name + "/shared", [&] { doNotOptimize(tree.program().run(input, &cache)); });
+}
@@ -0,0 +1,66 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "MatrixKernels.h"
+#include "SimdKernels.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    void naiveGemm(int n, const int* a, const int* b, int* c)
+    {
+        for (int i = 0; i < n; ++i)
+            for (int j = 0; j < n; ++j)
+            {
+                int sum = 0;
+                for (int k = 0; k < n; ++k)
+                    sum += a[i * n + k] * b[k * n + j];
+                c[i * n + j] = sum;
+            }
+    }
+
+    std::vector<int> makeValues(int n)
+    {
+        auto values = std::vector<int>(static_cast<std::size_t>(n) * static_cast<std::size_t>(n));
+        for (std::size_t i = 0; i < values.size(); ++i)
+            values[i] = static_cast<int>(i % 7) - 3;
+        return values;
+    }
+}
+
+
+void bench::runMulBenchmarks(Runner& runner)
+{
+    for (const int size : { 64, 256, 512, 1024 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        const auto flops = 2.0 * size * size * size;
+
+        const auto a = makeValues(size);
+        const auto b = makeValues(size);
+        auto c = std::vector<int>(a.size());
+
+        if (size <= 512)
+        {
+            const auto naive = runner.run("mul/naive" + suffix, [&] { naiveGemm(size, a.data(), b.data(), c.data()); doNotOptimize(c); });
+            runner.counter("GFLOP/s", flops / naive, "GFLOP/s");
+        }
+        const auto blocked = runner.run("mul/blocked" + suffix, [&] { kernels::gemm(size, a.data(), b.data(), c.data()); doNotOptimize(c); });
+        runner.counter("GFLOP/s", flops / blocked, "GFLOP/s");
+        const auto dispatched = runner.run("mul/gemmInt" + suffix, [&] { kernels::gemmInt(size, a.data(), b.data(), c.data()); doNotOptimize(c); });
+        runner.counter("GFLOP/s", flops / dispatched, "GFLOP/s");
+
+        // operator* including the range check (identity keeps the product valid)
+        auto lhs = SquareMatrix<int>(size, 0);
+        auto identity = SquareMatrix<int>(size, 0);
+        for (int i = 0; i < size; ++i)
+        {
+            identity(i, i) = 1;
+            for (int j = 0; j < size; ++j)
+                lhs(i, j) = (i + j) % 7;
+        }
+        runner.run("mul/operator*" + suffix, [&] { doNotOptimize(lhs * identity); });
+    }
+}
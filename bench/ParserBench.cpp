@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+#include "MatrixParser.h"
+
+#include <sstream>
+#include <string>
+
+
+void bench::runParserBenchmarks(Runner& runner)
+{
+    for (const int size : { 4, 256 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>(i * 37 % 2047) - 1023;
+
+        // about 4 MB of text, one matrix row per line
+        auto out = std::ostringstream();
+        auto count = std::size_t(0);
+        while (out.tellp() < (std::streampos(4) << 20))
+        {
+            out << matrix << '\n';
+            ++count;
+        }
+        const auto text = std::move(out).str();
+        const auto megabytes = static_cast<double>(text.size()) / 1e6;
+        const auto report = [&](const std::string& name, double ns) {
+            runner.counter(name + "/throughput", megabytes * 1e9 / ns, "MB/s");
+        };
+
+        // the formatted read with a range check per value
+        auto name = "parser/operator>>" + suffix;
+        report(name, runner.run(name, [&] {
+            auto in = std::istringstream(text);
+            for (std::size_t k = 0; k < count; ++k)
+                in >> matrix;
+            doNotOptimize(matrix);
+        }));
+
+        name = "parser/from_chars-stream" + suffix;
+        report(name, runner.run(name, [&] {
+            auto in = std::istringstream(text);
+            auto parser = MatrixParser(in, MatrixParser::Mode::Stream);
+            for (std::size_t k = 0; k < count; ++k)
+                parser.read(matrix);
+            doNotOptimize(matrix);
+        }));
+
+        // as eval reads: a line at a time
+        name = "parser/from_chars-lines" + suffix;
+        report(name, runner.run(name, [&] {
+            auto in = std::istringstream(text);
+            auto parser = MatrixParser(in, MatrixParser::Mode::Lines);
+            for (std::size_t k = 0; k < count; ++k)
+                parser.read(matrix);
+            doNotOptimize(matrix);
+        }));
+    }
+}
@@ -0,0 +1,42 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+
+#include <string>
+
+
+namespace
+{
+    // The same work under every range policy; the values stay valid, so this
+    // is the cost of the checks on the fast path
+    template <typename Policy>
+    void runPolicy(bench::Runner& runner, const std::string& policy, int size)
+    {
+        const auto suffix = "/" + policy + "/" + std::to_string(size);
+        auto lhs = SquareMatrix<int, Policy>(size, 0);
+        auto rhs = SquareMatrix<int, Policy>(size, 0);
+        for (std::size_t i = 0; i < lhs.count(); ++i)
+        {
+            lhs.data()[i] = static_cast<int>(i % 7) - 3;
+            rhs.data()[i] = static_cast<int>(i % 5) - 2;
+        }
+
+        runner.run("policy/add" + suffix, [&] { bench::doNotOptimize(SquareMatrix<int, Policy>(lhs + rhs)); });
+        runner.run("policy/scale" + suffix, [&] { bench::doNotOptimize(SquareMatrix<int, Policy>(lhs * 3)); });
+        runner.run("policy/fused" + suffix, [&] { bench::doNotOptimize(SquareMatrix<int, Policy>(lhs + rhs * 2 - lhs)); });
+        if (size <= 256)
+            runner.run("policy/mul" + suffix, [&] { bench::doNotOptimize(lhs * rhs); });
+    }
+}
+
+
+void bench::runPolicyBenchmarks(Runner& runner)
+{
+    for (const int size : { 64, 256, 1024 })
+    {
+        runPolicy<ThrowingRange>(runner, "throwing", size);
+        runPolicy<SaturatingRange>(runner, "saturating", size);
+        runPolicy<WrappingRange>(runner, "wrapping", size);
+        runPolicy<DeferredRange>(runner, "deferred", size);
+        runPolicy<UncheckedRange>(runner, "unchecked", size);
+    }
+}
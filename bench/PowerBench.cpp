@@ -0,0 +1,68 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "MatrixPower.h"
+#include "EvalCache.h"
+#include "Identity.h"
+#include "Pow.h"
+#include "OperationPool.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // a row-stochastic matrix: its powers stay in [0, 1] for any k
+    SquareMatrix<double> makeMarkov(int size)
+    {
+        auto matrix = SquareMatrix<double>(size, 0.0);
+        for (int i = 0; i < size; ++i)
+        {
+            auto sum = 0.0;
+            for (int j = 0; j < size; ++j)
+                sum += matrix(i, j) = 1.0 + (i * 7 + j * 3) % 5;
+            for (int j = 0; j < size; ++j)
+                matrix(i, j) /= sum;
+        }
+        return matrix;
+    }
+}
+
+
+void bench::runPowerBenchmarks(Runner& runner)
+{
+    constexpr int size = 64;
+    const auto base = makeMarkov(size);
+    const auto suffix = "/" + std::to_string(size);
+
+    for (const int k : { 16, 1000 })
+    {
+        const auto name = "power/k" + std::to_string(k);
+        // what chaining mul by hand computes: k - 1 products
+        runner.run(name + "/chain" + suffix, [&] {
+            auto result = base;
+            for (int i = 1; i < k; ++i)
+                result = powerProduct(result, base);
+            doNotOptimize(result);
+        });
+        runner.run(name + "/square-multiply" + suffix, [&] { doNotOptimize(power(base, k)); });
+        runner.counter("products", powerProducts(k), "");
+    }
+
+    // pow 1000 and then pow 999 of the same matrix: with a cache the second
+    // eval starts from the squares of the first one
+    auto pool = OperationPool(false);
+    const auto identity = pool.emplace<Identity>();
+    const auto& first = pool[pool.apply<Pow>(identity, 1000)];
+    const auto& second = pool[pool.apply<Pow>(identity, 999)];
+    const auto input = std::vector<SquareMatrix<double>>{ base };
+    auto cache = EvalCache(64);
+    for (const bool cached : { false, true })
+    {
+        runner.run(std::string("power/program/k1000+k999") + (cached ? "/cached-squares" : "/computed") + suffix, [&] {
+            cache.clear();
+            doNotOptimize(first.program().run(input, cached ? &cache : nullptr));
+            doNotOptimize(second.program().run(input, cached ? &cache : nullptr));
+        });
+    }
+}
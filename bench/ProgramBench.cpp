@@ -0,0 +1,218 @@
+#include "Benchmark.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Comp.h"
+#include "Scalar.h"
+#include "Transpose.h"
+#include "Identity.h"
+#include "Mul.h"
+#include "EvalCache.h"
+#include "ThreadPool.h"
+#include "BatchEvaluator.h"
+#include "MatrixPool.h"
+#include "OperationPool.h"
+
+#include <optional>
+#include <vector>
+#include <string>
+#include <sstream>
+
+
+namespace
+{
+    // The trees are built in a pool without interning, so that equal
+    // subtrees stay distinct nodes, as written
+
+    // depth levels of alternating add / sub over identity and transpose leaves
+    const Operation& makeChain(OperationPool& pool, int depth)
+    {
+        auto op = pool.emplace<Identity>();
+        for (int i = 0; i < depth; ++i)
+        {
+            if (i % 2 == 0)
+                op = pool.combine<Add>(op, pool.emplace<Transpose>());
+            else
+                op = pool.combine<Sub>(op, pool.emplace<Identity>());
+        }
+        return pool[op];
+    }
+
+    // depth levels of composition: tran -> (id + id) -> tran -> ...
+    const Operation& makeCompChain(OperationPool& pool, int depth)
+    {
+        auto op = pool.emplace<Transpose>();
+        const auto sum = pool.combine<Sub>(pool.emplace<Identity>(), pool.emplace<Identity>());
+        for (int i = 0; i < depth; ++i)
+        {
+            op = pool.combine<Comp>(op, i % 2 == 0 ? sum : pool.emplace<Transpose>());
+        }
+        return pool[op];
+    }
+
+    // depth levels of sub over the same operation twice: sub 2 2, sub 3 3, ...
+    // on top of id * id, the shape the result cache is meant for
+    const Operation& makeShared(OperationPool& pool, int depth)
+    {
+        auto op = pool.combine<Mul>(pool.emplace<Identity>(), pool.emplace<Identity>());
+        for (int i = 0; i < depth; ++i)
+        {
+            op = pool.combine<Sub>(op, op);
+        }
+        return pool[op];
+    }
+
+    // a balanced tree of add with depth levels over id * id leaves
+    OperationHandle makeWide(OperationPool& pool, int depth)
+    {
+        if (depth == 0)
+            return pool.combine<Mul>(pool.emplace<Identity>(), pool.emplace<Identity>());
+        return pool.combine<Add>(makeWide(pool, depth - 1), makeWide(pool, depth - 1));
+    }
+
+    // width branches added together; each branch has depth levels that
+    // alternate comp with scal -1 and sub of the transpose of its input
+    const Operation& makeTree(OperationPool& pool, int depth, int width)
+    {
+        auto tree = std::optional<OperationHandle>();
+        for (int w = 0; w < width; ++w)
+        {
+            auto op = pool.emplace<Identity>();
+            for (int i = 0; i < depth; ++i)
+            {
+                if (i % 2 == 0)
+                    op = pool.combine<Comp>(op, pool.emplace<Scalar>(-1));
+                else
+                    op = pool.combine<Sub>(op, pool.emplace<Transpose>());
+            }
+            tree = tree ? pool.combine<Add>(*tree, op) : op;
+        }
+        return pool[*tree];
+    }
+
+    std::vector<Operation::T> makeInput(int count, int size)
+    {
+        auto input = std::vector<Operation::T>();
+        for (int k = 0; k < count; ++k)
+        {
+            auto matrix = Operation::T(size, 0);
+            for (std::size_t i = 0; i < matrix.count(); ++i)
+                matrix.data()[i] = static_cast<int>((i + static_cast<std::size_t>(k)) % 3) - 1;
+            input.push_back(matrix);
+        }
+        return input;
+    }
+}
+
+
+void bench::runProgramBenchmarks(Runner& runner)
+{
+    auto pool = OperationPool(false);
+
+    for (const int depth : { 8, 64, 256 })
+    {
+        for (const int size : { 4, 128 })
+        {
+            const auto suffix = "/depth" + std::to_string(depth) + "/" + std::to_string(size);
+
+            const auto& chain = makeChain(pool, depth);
+            const auto chainInput = makeInput(chain.inputCount(), size);
+            runner.run("program/chain/recursive" + suffix, [&] { doNotOptimize(chain.compute(chainInput)); });
+            runner.run("program/chain/compiled" + suffix, [&] { doNotOptimize(chain.program().run(chainInput)); });
+
+            const auto& comp = makeCompChain(pool, depth);
+            const auto compInput = makeInput(comp.inputCount(), size);
+            runner.run("program/comp/recursive" + suffix, [&] { doNotOptimize(comp.compute(compInput)); });
+            runner.run("program/comp/compiled" + suffix, [&] { doNotOptimize(comp.program().run(compInput)); });
+        }
+    }
+
+    for (const int depth : { 2, 8 })
+    {
+        for (const int width : { 1, 4 })
+        {
+            for (const int size : { 4, 64 })
+            {
+                const auto suffix = "/depth" + std::to_string(depth) + "/width" + std::to_string(width) + "/" + std::to_string(size);
+                const auto& tree = makeTree(pool, depth, width);
+                const auto input = makeInput(tree.inputCount(), size);
+                runner.run("program/tree/recursive" + suffix, [&] { doNotOptimize(tree.compute(input)); });
+                runner.run("program/tree/compiled" + suffix, [&] { doNotOptimize(tree.program().run(input)); });
+            }
+        }
+    }
+
+    // the same evaluations with and without the buffer reuse of the MatrixPool
+    for (const bool reuse : { false, true })
+    {
+        MatrixPool::setEnabled(reuse);
+        const auto mode = std::string(reuse ? "/pooled" : "/heap");
+
+        const auto& tree = makeTree(pool, 8, 4);
+        const auto treeInput = makeInput(tree.inputCount(), 64);
+        runner.run("program/pool/tree/recursive" + mode + "/depth8/width4/64", [&] { doNotOptimize(tree.compute(treeInput)); });
+        runner.run("program/pool/tree/compiled" + mode + "/depth8/width4/64", [&] { doNotOptimize(tree.program().run(treeInput)); });
+
+        const auto& chain = makeChain(pool, 64);
+        const auto chainInput = makeInput(chain.inputCount(), 128);
+        runner.run("program/pool/chain/compiled" + mode + "/depth64/128", [&] { doNotOptimize(chain.program().run(chainInput)); });
+    }
+    MatrixPool::setEnabled(true);
+
+    for (const int depth : { 4, 8 })
+    {
+        const auto suffix = "/depth" + std::to_string(depth) + "/64";
+        const auto& shared = makeShared(pool, depth);
+        // equal inputs, so that the cache also hits across the two halves of every sub
+        const auto input = std::vector<Operation::T>(static_cast<std::size_t>(shared.inputCount()), makeInput(1, 64).front());
+        runner.run("program/shared/recursive" + suffix, [&] { doNotOptimize(shared.compute(input)); });
+        runner.run("program/shared/compiled" + suffix, [&] { doNotOptimize(shared.program().run(input)); });
+
+        auto cache = EvalCache();
+        runner.run("program/shared/memo" + suffix, [&] { doNotOptimize(shared.program().run(input, &cache)); });
+        runner.counter("program/shared/memo" + suffix + "/hit-rate", 100.0 * static_cast<double>(cache.hits()) / static_cast<double>(cache.hits() + cache.misses()), "%");
+
+        auto lru = EvalCache(64);
+        runner.run("program/shared/memo-lru" + suffix, [&] { doNotOptimize(shared.program().run(input, &lru)); });
+        runner.counter("program/shared/memo-lru" + suffix + "/hit-rate", 100.0 * static_cast<double>(lru.hits()) / static_cast<double>(lru.hits() + lru.misses()), "%");
+    }
+
+    // the identity matrix as every input keeps the sums in range
+    for (const int size : { 64, 256 })
+    {
+        const auto suffix = "/depth3/" + std::to_string(size);
+        const auto& wide = pool[makeWide(pool, 3)];
+        auto identity = Operation::T(size, 0);
+        for (int i = 0; i < size; ++i)
+            identity.data()[static_cast<std::size_t>(i) * static_cast<std::size_t>(size) + static_cast<std::size_t>(i)] = 1;
+        const auto input = std::vector<Operation::T>(static_cast<std::size_t>(wide.inputCount()), identity);
+
+        runner.run("program/wide/serial" + suffix, [&] { doNotOptimize(wide.program().run(input)); });
+        for (const int workers : { 2, 4, ThreadPool::defaultWorkerCount() })
+        {
+            auto threads = ThreadPool(workers);
+            runner.run("program/wide/pool" + std::to_string(workers) + suffix, [&] { doNotOptimize(wide.program().run(input, nullptr, &threads)); });
+        }
+    }
+
+    // beval: 4096 sets of two 8 x 8 matrices through scal 3 + tran
+    {
+        const auto& op = pool[pool.combine<Add>(pool.emplace<Scalar>(3), pool.emplace<Transpose>())];
+        auto text = std::ostringstream();
+        for (int set = 0; set < 4096; ++set)
+            for (const auto& matrix : makeInput(op.inputCount(), 8))
+                text << matrix;
+        const auto file = text.str();
+
+        for (const int workers : { 1, ThreadPool::defaultWorkerCount() })
+        {
+            auto threads = ThreadPool(workers);
+            const auto name = "program/beval/pool" + std::to_string(workers) + "/4096x8";
+            const auto ns = runner.run(name, [&] {
+                auto in = std::istringstream(file);
+                auto out = std::ostringstream();
+                doNotOptimize(BatchEvaluator(op.program(), 8, &threads).run(in, out));
+            });
+            runner.counter(name + "/throughput", 4096.0 * 1e9 / ns, "sets/s");
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#include "Benchmark.h"
+#include "FunctionCalculator.h"
+#include "BufferedOutput.h"
+
+#include <sstream>
+#include <string>
+
+
+namespace
+{
+    // cycles of: scal 2, add 0 2, eval of the add (two 2x2 matrices on the
+    // next lines), del 3, del 2 - five commands, the list back as it was
+    std::string makeScript(std::size_t lines, std::size_t& commands)
+    {
+        auto script = std::string();
+        commands = 0;
+        for (std::size_t line = 0; line + 7 <= lines; line += 7)
+        {
+            script += "scal 2\nadd 0 2\neval 3 2\n1 2 3 4\n5 6 7 8\ndel 3\ndel 2\n";
+            commands += 5;
+        }
+        return script;
+    }
+}
+
+
+void bench::runScriptBenchmarks(Runner& runner)
+{
+    auto commands = std::size_t(0);
+    const auto script = makeScript(100000, commands);
+    const auto report = [&](const std::string& name, double ns) {
+        runner.counter(name + "/commands", static_cast<double>(commands) * 1e9 / ns, "commands/s");
+    };
+
+    // the file mode of read: the menu after every command
+    auto name = std::string("script/file-mode/100k");
+    report(name, runner.run(name, [&] {
+        auto in = std::istringstream(script);
+        auto out = std::ostringstream();
+        FunctionCalculator(out).run(in, true);
+        doNotOptimize(out);
+    }));
+
+    name = "script/headless/100k";
+    report(name, runner.run(name, [&] {
+        auto in = std::istringstream(script);
+        auto out = std::ostringstream();
+        auto buffer = BufferedOutput(out);
+        auto output = std::ostream(&buffer);
+        FunctionCalculator(output).runScript(in, FunctionCalculator::ErrorPolicy::Abort);
+        doNotOptimize(out);
+    }));
+}
@@ -0,0 +1,74 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "SparseMatrix.h"
+#include "Program.h"
+#include "Add.h"
+#include "Mul.h"
+#include "Scalar.h"
+#include "Identity.h"
+#include "OperationPool.h"
+
+#include <cstdint>
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // about percent % of the values are non-zero (-2 .. 2), spread by a fixed LCG
+    SquareMatrix<int> makeMatrix(int size, int percent, std::uint32_t seed)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 8) % 100 < static_cast<std::uint32_t>(percent))
+                matrix.data()[i] = (seed >> 4) % 2 == 0 ? 1 + static_cast<int>(seed >> 28) % 2 : -1 - static_cast<int>(seed >> 28) % 2;
+        }
+        return matrix;
+    }
+}
+
+
+void bench::runSparseBenchmarks(Runner& runner)
+{
+    constexpr int size = 256;
+    const auto suffix = "/" + std::to_string(size);
+
+    // (id + scal 2) * id, as eval runs it
+    auto pool = OperationPool(false);
+    const auto sum = pool.combine<Add>(pool.emplace<Identity>(), pool.emplace<Scalar>(2));
+    const auto& tree = pool[pool.combine<Mul>(sum, pool.emplace<Identity>())];
+
+    for (const int percent : { 1, 2, 3, 5, 10, 25, 50 })
+    {
+        const auto name = "sparse/" + std::to_string(percent) + "%";
+        const auto lhs = makeMatrix(size, percent, 1);
+        const auto rhs = makeMatrix(size, percent, 2);
+        const auto sparseLhs = SparseMatrix<int>(lhs);
+        const auto sparseRhs = SparseMatrix<int>(rhs);
+
+        runner.run(name + "/convert" + suffix, [&] { doNotOptimize(SparseMatrix<int>(lhs)); });
+        runner.counter("csr bytes", static_cast<double>(sparseLhs.bytes()), "B");
+        runner.counter("dense bytes", static_cast<double>(lhs.count() * sizeof(int)), "B");
+
+        runner.run(name + "/add/dense" + suffix, [&] { doNotOptimize(SquareMatrix<int>(lhs + rhs)); });
+        runner.run(name + "/add/csr" + suffix, [&] { doNotOptimize(SparseMatrix<int>::add(sparseLhs, sparseRhs)); });
+        runner.run(name + "/transpose/dense" + suffix, [&] { doNotOptimize(lhs.Transpose()); });
+        runner.run(name + "/transpose/csr" + suffix, [&] { doNotOptimize(sparseLhs.Transpose()); });
+        runner.run(name + "/mul/dense" + suffix, [&] { doNotOptimize(lhs * rhs); });
+        runner.run(name + "/mul/csr-dense" + suffix, [&] { doNotOptimize(SparseMatrix<int>::multiply(sparseLhs, rhs)); });
+        runner.run(name + "/mul/csr-csr" + suffix, [&] { doNotOptimize(SparseMatrix<int>::multiply(sparseLhs, sparseRhs)); });
+
+        // a whole eval, with the representation picked by run() and always dense
+        auto input = std::vector<SquareMatrix<int>>();
+        for (int i = 0; i < tree.inputCount(); ++i)
+            input.push_back(i % 2 == 0 ? lhs : rhs);
+        for (const bool sparse : { true, false })
+        {
+            Program::setSparseEnabled(sparse);
+            runner.run(name + "/program" + (sparse ? "/auto" : "/dense") + suffix, [&] { doNotOptimize(tree.program().run(input)); });
+        }
+        Program::setSparseEnabled(true);
+    }
+}
@@ -0,0 +1,84 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // The previous SquareMatrix layout (one std::vector per row), kept here
+    // only as the baseline the flat storage is measured against
+    struct NestedMatrix
+    {
+        explicit NestedMatrix(int size)
+            : m_size(static_cast<std::size_t>(size)), m_matrix(m_size, std::vector<int>(m_size))
+        {
+            for (std::size_t i = 0; i < m_size * m_size; ++i)
+                m_matrix[i / m_size][i % m_size] = static_cast<int>(i);
+        }
+
+        NestedMatrix operator+(const NestedMatrix& rhs) const
+        {
+            NestedMatrix result(static_cast<int>(m_size));
+            for (std::size_t i = 0; i < m_size; ++i)
+                for (std::size_t j = 0; j < m_size; ++j)
+                {
+                    const int sum = m_matrix[i][j] + rhs.m_matrix[i][j];
+                    if (sum <= MIN_ALLOWED_VALU || sum >= MAX_ALLOWED_VALUE)
+                        throw FileException("the value: " + std::to_string(sum) + " ,is invalid value");
+                    result.m_matrix[i][j] = sum;
+                }
+            return result;
+        }
+
+        NestedMatrix transpose() const
+        {
+            NestedMatrix result(static_cast<int>(m_size));
+            for (std::size_t i = 0; i < m_size; ++i)
+                for (std::size_t j = 0; j < m_size; ++j)
+                    result.m_matrix[i][j] = m_matrix[j][i];
+            return result;
+        }
+
+        std::size_t m_size;
+        std::vector<std::vector<int>> m_matrix;
+    };
+
+    NestedMatrix makeNested(int size)
+    {
+        auto matrix = NestedMatrix(size);
+        for (std::size_t i = 0; i < matrix.m_size * matrix.m_size; ++i)
+            matrix.m_matrix[i / matrix.m_size][i % matrix.m_size] = static_cast<int>(i % 7);
+        return matrix;
+    }
+
+    SquareMatrix<int> makeFlat(int size)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>(i % 7);
+        return matrix;
+    }
+}
+
+
+void bench::runStorageBenchmarks(Runner& runner)
+{
+    for (const int size : { 4, 64, 256, 1024, 2048 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+
+        const auto nestedA = makeNested(size);
+        const auto nestedB = makeNested(size);
+        runner.run("storage/nested/construct" + suffix, [&] { doNotOptimize(NestedMatrix(size)); });
+        runner.run("storage/nested/add" + suffix, [&] { doNotOptimize(nestedA + nestedB); });
+        runner.run("storage/nested/transpose" + suffix, [&] { doNotOptimize(nestedA.transpose()); });
+
+        const auto flatA = makeFlat(size);
+        const auto flatB = makeFlat(size);
+        runner.run("storage/flat/construct" + suffix, [&] { doNotOptimize(SquareMatrix<int>(size)); });
+        runner.run("storage/flat/add" + suffix, [&] { doNotOptimize(SquareMatrix<int>(flatA + flatB)); });
+        runner.run("storage/flat/transpose" + suffix, [&] { doNotOptimize(flatA.Transpose()); });
+    }
+}
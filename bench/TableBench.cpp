@@ -0,0 +1,87 @@
+#include "Benchmark.h"
+#include "OperationPool.h"
+#include "Add.h"
+#include "Sub.h"
+#include "Comp.h"
+#include "Scalar.h"
+#include "Identity.h"
+#include "Transpose.h"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+    // A library like the generated scripts: count operations over the ones
+    // before them, with few distinct scalars, so that many are duplicates.
+    // In an interning pool every operation is interned as it is created.
+    std::vector<OperationHandle> makeLibrary(OperationPool& pool, int count)
+    {
+        auto random = std::mt19937(7);
+        auto library = std::vector<OperationHandle>{ pool.emplace<Identity>(), pool.emplace<Transpose>() };
+        for (int i = 0; i < count; ++i)
+        {
+            const auto pick = [&] { return library[std::uniform_int_distribution<std::size_t>(0, std::min<std::size_t>(library.size(), 8) - 1)(random)]; };
+            switch (random() % 4)
+            {
+            case 0: library.push_back(pool.emplace<Scalar>(static_cast<int>(random() % 3))); break;
+            case 1: library.push_back(pool.combine<Add>(pick(), pick())); break;
+            case 2: library.push_back(pool.combine<Sub>(pick(), pick())); break;
+            default: library.push_back(pool.combine<Comp>(pick(), pick())); break;
+            }
+        }
+        return library;
+    }
+
+    // Structural equality without the table: compare the printed trees
+    bool printedEqual(const Operation& a, const Operation& b)
+    {
+        auto lhs = std::ostringstream();
+        auto rhs = std::ostringstream();
+        a.print(lhs, true);
+        b.print(rhs, true);
+        return lhs.str() == rhs.str();
+    }
+}
+
+
+void bench::runTableBenchmarks(Runner& runner)
+{
+    for (const int count : { 1000, 100000 })
+    {
+        const auto suffix = "/" + std::to_string(count);
+        runner.run("table/build/plain" + suffix, [&] {
+            auto pool = OperationPool(false);
+            doNotOptimize(makeLibrary(pool, count));
+        });
+        runner.run("table/build/interned" + suffix, [&] {
+            auto pool = OperationPool();
+            doNotOptimize(makeLibrary(pool, count));
+        });
+        // del of every operation, the last one first; each one frees its nodes in O(1)
+        runner.run("table/build-delete/interned" + suffix, [&] {
+            auto pool = OperationPool();
+            const auto library = makeLibrary(pool, count);
+            for (auto it = library.rbegin(); it != library.rend(); ++it)
+                pool.release(*it);
+            doNotOptimize(pool.size());
+        });
+    }
+
+    constexpr int count = 1000;
+    auto interned = OperationPool();
+    auto plain = OperationPool(false);
+    const auto internedLibrary = makeLibrary(interned, count);
+    const auto plainLibrary = makeLibrary(plain, count);
+    runner.counter("table/distinct/1000", static_cast<double>(interned.size()), "nodes");
+
+    const auto& a = plain[plainLibrary[plainLibrary.size() - 1]];
+    const auto& b = plain[plainLibrary[plainLibrary.size() - 2]];
+    runner.run("table/equal/printed", [&] { doNotOptimize(printedEqual(a, b)); });
+    const auto& x = interned[internedLibrary[internedLibrary.size() - 1]];
+    const auto& y = interned[internedLibrary[internedLibrary.size() - 2]];
+    runner.run("table/equal/interned", [&] { doNotOptimize(OperationTable::equal(x, y)); });
+}
@@ -0,0 +1,55 @@
+#include "Benchmark.h"
+#include "SquareMatrix.h"
+#include "Transpose.h"
+
+#include <vector>
+#include <string>
+
+
+namespace
+{
+    // The previous Transpose: element by element, every read a stride of one row
+    SquareMatrix<int> naiveTranspose(const SquareMatrix<int>& matrix)
+    {
+        auto result = SquareMatrix<int>(matrix.size(), 0);
+        const auto n = static_cast<std::size_t>(matrix.size());
+        for (std::size_t i = 0; i < n; ++i)
+            for (std::size_t j = 0; j < n; ++j)
+                result.data()[i * n + j] = matrix.data()[j * n + i];
+        return result;
+    }
+}
+
+
+void bench::runTransposeBenchmarks(Runner& runner)
+{
+    // 256 KiB (in L2), 4 MiB (beyond L2), 16 MiB and 64 MiB (beyond L3)
+    for (const int size : { 256, 1024, 2048, 4096 })
+    {
+        const auto suffix = "/" + std::to_string(size);
+        auto matrix = SquareMatrix<int>(size, 0);
+        for (std::size_t i = 0; i < matrix.count(); ++i)
+            matrix.data()[i] = static_cast<int>(i % 7);
+        // read and written once
+        const auto bytes = 2.0 * static_cast<double>(matrix.count() * sizeof(int));
+
+        const auto report = [&](const std::string& name, double ns) {
+            runner.counter(name + "/bandwidth", bytes / ns, "GB/s");
+        };
+
+        auto name = "transpose/naive" + suffix;
+        report(name, runner.run(name, [&] { doNotOptimize(naiveTranspose(matrix)); }));
+
+        name = "transpose/blocked" + suffix;
+        report(name, runner.run(name, [&] { doNotOptimize(matrix.Transpose()); }));
+
+        // transposing twice leaves the matrix as it was
+        name = "transpose/in-place" + suffix;
+        report(name, runner.run(name, [&] { matrix.transposeInPlace(); doNotOptimize(matrix); }));
+
+        // comp whose second operation takes over the result of the first
+        const auto op = Transpose();
+        name = "transpose/consume" + suffix;
+        report(name, runner.run(name, [&] { doNotOptimize(op.consume(SquareMatrix<int>(matrix))); }));
+    }
+}
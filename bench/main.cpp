@@ -0,0 +1,57 @@
+#include "Benchmark.h"
+
+#include <string>
+#include <fstream>
+#include <iostream>
+
+
+// usage: oop2_bench [filter] [--json FILE] - runs the benchmarks whose name
+// contains filter, and writes their results to FILE as JSON
+int main(int argc, char* argv[])
+{
+    auto filter = std::string();
+    auto json = std::string();
+    for (int i = 1; i < argc; ++i)
+    {
+        const auto arg = std::string(argv[i]);
+        if (arg == "--json" && i + 1 < argc)
+            json = argv[++i];
+        else if (filter.empty() && !arg.starts_with("--"))
+            filter = arg;
+        else
+        {
+            std::cerr << "usage: oop2_bench [filter] [--json FILE]\n";
+            return 2;
+        }
+    }
+    auto runner = bench::Runner(std::cout, filter);
+
+    bench::runStorageBenchmarks(runner);
+    bench::runMulBenchmarks(runner);
+    bench::runElementwiseBenchmarks(runner);
+    bench::runFusionBenchmarks(runner);
+    bench::runProgramBenchmarks(runner);
+    bench::runTransposeBenchmarks(runner);
+    bench::runTableBenchmarks(runner);
+    bench::runPolicyBenchmarks(runner);
+    bench::runFixedBenchmarks(runner);
+    bench::runFileBenchmarks(runner);
+    bench::runParserBenchmarks(runner);
+    bench::runScriptBenchmarks(runner);
+    bench::runFormatBenchmarks(runner);
+    bench::runElementTypeBenchmarks(runner);
+    bench::runSparseBenchmarks(runner);
+    bench::runPowerBenchmarks(runner);
+    bench::runLuBenchmarks(runner);
+
+    if (!json.empty())
+    {
+        auto file = std::ofstream(json);
+        runner.writeJson(file);
+        if (!file)
+        {
+            std::cerr << "cannot write " << json << '\n';
+            return 1;
+        }
+    }
+}
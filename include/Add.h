@@ -9,6 +9,7 @@ class Add : public BinaryOperation
 {
 public:
     using BinaryOperation::BinaryOperation;
-    T compute(const std::vector<T>& input) const override;
+    T compute(Input input) const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
     void printSymbol(std::ostream& ostr) const override;
 };
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Program.h"
+
+#include <cstddef>
+#include <iosfwd>
+#include <span>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+class MatrixFile;
+class MatrixFileWriter;
+class MatrixParser;
+
+// Number of input sets read, evaluated and written at a time
+constexpr std::size_t BATCH_EVAL_CHUNK = 256;
+
+
+// Applies one compiled operation to every input set of a stream.
+//
+// An input set is program.inputCount() size x size matrices, whitespace
+// separated as typed for eval. The sets are streamed in chunks: a chunk is
+// read, evaluated (each set on its own) and formatted in parallel on the
+// pool, then written in input order, each result followed by an empty line.
+// A set whose values or result are out of range gets the error message in
+// place of its result; a stream that is not a whole number of sets of
+// numbers is a FileException.
+//
+// The sets may also come from a MatrixFile, whose consecutive matrices are
+// the sets: they are evaluated where they are mapped, without parsing.
+class BatchEvaluator
+{
+public:
+    // pool may be null (sequential evaluation)
+    BatchEvaluator(const Program& program, int size, ThreadPool* pool);
+
+    // Returns the number of input sets evaluated
+    std::size_t run(std::istream& istr, std::ostream& ostr) const;
+    std::size_t run(const MatrixFile& file, std::ostream& ostr) const;
+    // The results as a matrix file, which has no place for an error message:
+    // the first set with an error stops the evaluation (FileException)
+    std::size_t run(const MatrixFile& file, MatrixFileWriter& writer) const;
+
+private:
+    // the result of one set, after checking its values
+    template <typename M>
+    Program::T evaluate(std::span<const M> input) const;
+    // the result of one set as text, or its error message
+    template <typename M>
+    std::string format(std::span<const M> input) const;
+    // body(set) for set = 0 .. sets-1, in parallel on the pool
+    template <typename F>
+    void forEachSet(std::size_t sets, F body) const;
+    // the sets of file, size and count checked
+    std::vector<MatrixView<int>> views(const MatrixFile& file) const;
+
+    // reads up to BATCH_EVAL_CHUNK sets; false at the end of the stream
+    bool readChunk(MatrixParser& parser, std::size_t first, std::vector<Program::T>& chunk, std::size_t& sets) const;
+
+    const Program& m_program;
+    int m_size;
+    ThreadPool* m_pool;
+};
@@ -2,21 +2,57 @@
 
 #include "Operation.h"
 
-#include <memory>
+#include <optional>
 
 
+// The children are not owned: they live in the OperationPool that holds
+// this operation, which keeps them alive as long as it exists
 class BinaryOperation : public Operation
 {
 public:
-    BinaryOperation(const std::shared_ptr<Operation>& arg1, const std::shared_ptr<Operation>& arg2);
-	int inputCount() const override { return m_first->inputCount() + m_second->inputCount(); }
+    BinaryOperation(const Operation& arg1, const Operation& arg2);
+	int inputCount() const override { return m_firstCount + m_secondCount; }
+    Structure structure() const override;
 protected:
-    const std::shared_ptr<Operation>& first() const { return m_first; }
-    const std::shared_ptr<Operation>& second() const { return m_second; }
+    const Operation* first() const { return m_first; }
+    const Operation* second() const { return m_second; }
+    // inputCount() of the children, cached since the children never change
+    int firstCount() const { return m_firstCount; }
+    int secondCount() const { return m_secondCount; }
+    // the inputs of the second child: input without the first firstCount() matrices
+    Input secondInput(Input input) const { return input.drop(static_cast<std::size_t>(m_firstCount)); }
     virtual void printSymbol(std::ostream& ostr) const = 0;
     void print(std::ostream& ostr, bool first_print =false) const override;
 
+    // Evaluates both children and combines them element-wise with op(a, b)
+    // (an expression, see MatrixExpression.h) in one fused pass. A child that
+    // is a view of its input (Operation::term) is not materialized. The first
+    // child stays lazy only if that cannot change which error is reported
+    // first, i.e. when it cannot fail or the second child is lazy too.
+    template <typename Combine>
+    T combine(Input input, Combine op) const
+    {
+        auto firstResult = std::optional<T>();
+        auto secondResult = std::optional<T>();
+        const auto input2 = secondInput(input);
+
+        auto b = second()->term(input2);
+        auto a = first()->term(input);
+        if (!a || (a->checked() && !b))
+            a = Term(firstResult.emplace(first()->compute(input)));
+        if (!b)
+            b = Term(secondResult.emplace(second()->compute(input2)));
+
+        return op(*a, *b);
+    }
+
+    // compile() of an element-wise operation: the children's views are read
+    // by the instruction directly, with the same laziness rule as combine()
+    Program::Value compileElementwise(Program::Builder& builder, std::span<const Program::Value> input, Program::OpCode code) const;
+
 private:
-    const std::shared_ptr<Operation> m_first;
-    const std::shared_ptr<Operation> m_second;
+    const Operation* const m_first;
+    const Operation* const m_second;
+    const int m_firstCount;
+    const int m_secondCount;
 };
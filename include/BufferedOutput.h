@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+// Bytes the script mode collects before writing to the output
+constexpr std::size_t SCRIPT_OUTPUT_BUFFER = std::size_t(1) << 20;
+
+
+// A stream buffer that collects the output in one large block and writes
+// it to another stream only when the block is full, on flush() and at the
+// end, instead of on every prompt as the console does
+class BufferedOutput : public std::streambuf
+{
+public:
+    BufferedOutput(std::ostream& target, std::size_t capacity = SCRIPT_OUTPUT_BUFFER);
+    ~BufferedOutput() override;
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* s, std::streamsize count) override;
+    int sync() override;
+
+private:
+    // writes what was collected to the target
+    bool drain();
+
+    std::ostream& m_target;
+    std::vector<char> m_buffer;
+};
@@ -11,7 +11,8 @@ class Comp : public BinaryOperation
 public:
     using BinaryOperation::BinaryOperation;
     int inputCount() const override;
-    T compute(const std::vector<T>& input) const override;
+    T compute(Input input) const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
     void printSymbol(std::ostream& ostr) const override;
    
 };
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "FactoredOperation.h"
+
+
+// det(base) * I, so that the result is a matrix of the size of the input
+class Det : public FactoredOperation
+{
+public:
+    using FactoredOperation::FactoredOperation;
+
+protected:
+    T result(const LuFactorization<int>& factorization) const override;
+    Program::OpCode code() const override;
+    const char* name() const override;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+
+// The element types a compiled operation is evaluated on (eval num n type).
+// The operation tree and its Program do not depend on it: Program::run is
+// instantiated for each of these types and eval picks one.
+enum class ElementType
+{
+    Int,    // int, the default
+    Int64,  // std::int64_t
+    Float,
+    Double,
+};
+
+// The name of the type in a command, and back
+const char* elementTypeName(ElementType type);
+std::optional<ElementType> parseElementType(std::string_view name);
+
+// The ElementType of the C++ type E
+template <typename E>
+constexpr ElementType elementTypeOf()
+{
+    if constexpr (std::is_same_v<E, std::int64_t>)
+        return ElementType::Int64;
+    else if constexpr (std::is_same_v<E, float>)
+        return ElementType::Float;
+    else if constexpr (std::is_same_v<E, double>)
+        return ElementType::Double;
+    else
+    {
+        static_assert(std::is_same_v<E, int>, "not an element type of the calculator");
+        return ElementType::Int;
+    }
+}
+
+// f(std::type_identity<E>()) for the C++ type E of type
+template <typename F>
+decltype(auto) visitElementType(ElementType type, F&& f)
+{
+    switch (type)
+    {
+    case ElementType::Int64:  return f(std::type_identity<std::int64_t>());
+    case ElementType::Float:  return f(std::type_identity<float>());
+    case ElementType::Double: return f(std::type_identity<double>());
+    default:                  return f(std::type_identity<int>());
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "SquareMatrix.h"
+#include "ElementType.h"
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+
+// Memoized results of sub-operations, consulted by Program::run.
+//
+// An entry is keyed by the identity of an operation (Operation::id), the
+// element type of the eval and a digest of the input matrices it consumed, so
+// every distinct subcomputation runs once. A digest is two independent 64-bit
+// hashes: the index is built on the first and a hit must match both, so a
+// wrong hit takes a collision of both at once (about 2^-128 for two inputs). Entries added during an eval always live until the eval ends
+// (so repeated sub-operations within one eval are computed once); between
+// evals the most recently used capacity() entries are kept.
+class EvalCache
+{
+public:
+    struct Digest
+    {
+        std::uint64_t hash = 0;
+        std::uint64_t check = 0; // independent of hash, compared on a hit
+        bool operator==(const Digest&) const = default;
+    };
+
+    struct Key
+    {
+        std::uint64_t operation;
+        ElementType element;
+        Digest input;
+        bool operator==(const Key&) const = default;
+    };
+
+    // Key::operation of the squares base^(2^j) of a matrix power, keyed by
+    // the digest of the base and j (no Operation has id 0)
+    static constexpr std::uint64_t POWER_SQUARES = 0;
+    // Key::operation of the LuFactorization of a matrix, keyed by its digest
+    // (the ids count up from 1, so none reaches it); dropped when the eval ends
+    static constexpr std::uint64_t LU_FACTORIZATION = ~std::uint64_t(0);
+
+    // capacity: number of entries kept between evals (0 - cache within an eval only)
+    explicit EvalCache(std::size_t capacity = 0);
+
+    // find and insert may be called by several threads of one eval; the
+    // rest is meant for between evals. The result of a key is a matrix of
+    // its element type.
+    template <typename E>
+    std::shared_ptr<const SquareMatrix<E>> find(const Key& key)
+    {
+        return std::static_pointer_cast<const SquareMatrix<E>>(findEntry(key));
+    }
+    template <typename E>
+    void insert(const Key& key, std::shared_ptr<const SquareMatrix<E>> result)
+    {
+        insertEntry(key, std::move(result));
+    }
+    // The same for the other values an eval shares (an LuFactorization):
+    // the kind of the key decides their type
+    template <typename V>
+    std::shared_ptr<const V> findValue(const Key& key)
+    {
+        return std::static_pointer_cast<const V>(findEntry(key));
+    }
+    template <typename V>
+    void insertValue(const Key& key, std::shared_ptr<const V> value)
+    {
+        insertEntry(key, std::move(value));
+    }
+
+    // Drops the factorizations, then the least recently used entries beyond capacity()
+    void endEval();
+
+    std::size_t capacity() const { return m_capacity; }
+    void setCapacity(std::size_t capacity);
+    std::size_t size() const { return m_entries.size(); }
+    std::size_t hits() const { return m_hits; }
+    std::size_t misses() const { return m_misses; }
+    void resetCounters();
+    void clear();
+
+    // A fast digest of the size and the values of matrix
+    template <typename E>
+    static Digest digest(const SquareMatrix<E>& matrix)
+    {
+        return digest(matrix.size(), reinterpret_cast<const unsigned char*>(matrix.data()), matrix.count() * sizeof(E));
+    }
+    static std::uint64_t combine(std::uint64_t seed, std::uint64_t value);
+    static Digest combine(const Digest& seed, std::uint64_t value);
+    static Digest combine(const Digest& seed, const Digest& value);
+
+private:
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return static_cast<std::size_t>(combine(combine(key.operation, static_cast<std::uint64_t>(key.element)), key.input.hash));
+        }
+    };
+
+    // the results of all the element types, as the type of their key
+    using Entry = std::pair<Key, std::shared_ptr<const void>>;
+
+    std::shared_ptr<const void> findEntry(const Key& key);
+    void insertEntry(const Key& key, std::shared_ptr<const void> result);
+    static Digest digest(int size, const unsigned char* bytes, std::size_t length);
+
+    std::mutex m_mutex;
+    std::size_t m_capacity;
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+};
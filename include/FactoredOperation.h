@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Operation.h"
+#include "LuFactorization.h"
+
+
+// An operation on the LU factorization of the result of another one, its
+// base (Det, Inverse). Like the children of a BinaryOperation, the base is
+// not owned: it lives in the OperationPool that holds this operation.
+class FactoredOperation : public Operation
+{
+public:
+    explicit FactoredOperation(const Operation& base);
+    int inputCount() const override { return m_baseCount; }
+    T compute(Input input) const override;
+    Structure structure() const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
+    // name(base)
+    void print(std::ostream& ostr, bool first_print = false) const override;
+
+protected:
+    // the result, given the factorization of the base
+    virtual T result(const LuFactorization<int>& factorization) const = 0;
+    virtual Program::OpCode code() const = 0;
+    virtual const char* name() const = 0;
+
+private:
+    const Operation* const m_base;
+    const int m_baseCount;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <type_traits>
+
+
+// Sizes of the matrices Program::run evaluates as FixedSquareMatrix
+constexpr int FIXED_MATRIX_MIN_SIZE = 2;
+constexpr int FIXED_MATRIX_MAX_SIZE = 4;
+
+// An N x N matrix whose size is known at compile time: the elements are kept
+// inline (row-major, like SquareMatrix) and every operation is a fully
+// unrolled sequence of N * N element operations, without a heap allocation
+// or a loop bound read at run time.
+//
+// The range is checked as SquareMatrix<T, ThrowingRange> does: a result
+// outside (MIN_ALLOWED_VALU, MAX_ALLOWED_VALUE) throws a FileException for
+// the first invalid value, in the same order as the dynamic matrix.
+template <typename T, int N>
+class FixedSquareMatrix
+{
+public:
+    static_assert(N > 0, "FixedSquareMatrix needs a positive size");
+    static constexpr std::size_t Count = std::size_t(N) * std::size_t(N);
+
+    using value_type = T;
+
+    constexpr FixedSquareMatrix() = default;
+
+    // the N * N values of a row-major buffer
+    explicit FixedSquareMatrix(const T* values)
+    {
+        unrolled([&](auto i) { m_data[i] = values[i]; });
+    }
+
+    // the values of a dynamic matrix of size N
+    explicit FixedSquareMatrix(const SquareMatrix<T>& matrix) : FixedSquareMatrix(matrix.data()) {}
+
+    SquareMatrix<T> toSquareMatrix() const
+    {
+        auto result = SquareMatrix<T>(N, T());
+        unrolled([&](auto i) { result.data()[i] = m_data[i]; });
+        return result;
+    }
+
+    static constexpr int size() { return N; }
+    static constexpr std::size_t count() { return Count; }
+    constexpr T* data() { return m_data.data(); }
+    constexpr const T* data() const { return m_data.data(); }
+    constexpr T& operator()(int i, int j) { return m_data[std::size_t(i) * N + std::size_t(j)]; }
+    constexpr const T& operator()(int i, int j) const { return m_data[std::size_t(i) * N + std::size_t(j)]; }
+
+    friend constexpr FixedSquareMatrix operator+(const FixedSquareMatrix& lhs, const FixedSquareMatrix& rhs)
+    {
+        return checked([&](auto i) { return widen(lhs.m_data[i]) + widen(rhs.m_data[i]); });
+    }
+
+    friend constexpr FixedSquareMatrix operator-(const FixedSquareMatrix& lhs, const FixedSquareMatrix& rhs)
+    {
+        return checked([&](auto i) { return widen(lhs.m_data[i]) - widen(rhs.m_data[i]); });
+    }
+
+    friend constexpr FixedSquareMatrix operator*(const FixedSquareMatrix& matrix, const T& scalar)
+    {
+        return checked([&](auto i) { return widen(matrix.m_data[i]) * widen(scalar); });
+    }
+
+    // every dot product is accumulated in the wide type, so none can overflow;
+    // from zero and in the order of kernels::gemm, so that a floating point
+    // result is the same as the one of the dynamic matrix
+    friend constexpr FixedSquareMatrix operator*(const FixedSquareMatrix& lhs, const FixedSquareMatrix& rhs)
+    {
+        return checked([&](auto index) {
+            constexpr auto i = index / N;
+            constexpr auto j = index % N;
+            return [&]<std::size_t... K>(std::index_sequence<K...>) {
+                return (decltype(widen(T()))() + ... + (widen(lhs.m_data[i * N + K]) * widen(rhs.m_data[K * N + j])));
+            }(std::make_index_sequence<std::size_t(N)>());
+        });
+    }
+
+    constexpr FixedSquareMatrix Transpose() const
+    {
+        auto result = FixedSquareMatrix();
+        unrolled([&](auto index) { result.m_data[index] = m_data[(index % N) * N + index / N]; });
+        return result;
+    }
+
+private:
+    // f(i) for i = 0 .. Count-1, i as a compile time constant
+    template <typename F>
+    static constexpr void unrolled(F&& f)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (f(std::integral_constant<std::size_t, I>()), ...);
+        }(std::make_index_sequence<Count>());
+    }
+
+    // exact type for the results before the range check
+    static constexpr auto widen(const T& val)
+    {
+        if constexpr (std::is_integral_v<T>)
+            return static_cast<long long>(val);
+        else
+            return val;
+    }
+
+    // The matrix of the exact results valueAt(i); the range is tested without
+    // a branch per element and searched again only if some value is invalid
+    template <typename F>
+    static constexpr FixedSquareMatrix checked(F valueAt)
+    {
+        using Wide = decltype(widen(T()));
+        auto wide = std::array<Wide, Count>();
+        auto bad = false;
+        unrolled([&](auto i) {
+            wide[i] = valueAt(i);
+            bad |= (wide[i] <= Wide(MIN_ALLOWED_VALU)) | (wide[i] >= Wide(MAX_ALLOWED_VALUE));
+        });
+        if (bad)
+        {
+            for (const auto& val : wide)
+            {
+                if (val <= Wide(MIN_ALLOWED_VALU) || val >= Wide(MAX_ALLOWED_VALUE))
+                    throw FileException("the value: " + valueText(val) + " ,is invalid value");
+            }
+        }
+
+        auto result = FixedSquareMatrix();
+        unrolled([&](auto i) { result.m_data[i] = static_cast<T>(wide[i]); });
+        return result;
+    }
+
+    std::array<T, Count> m_data{};
+};
@@ -9,38 +9,71 @@
 #include <sstream>
 #include <string>
 #include <fstream>
+#include "EvalCache.h"
+#include "ThreadPool.h"
+#include "OperationPool.h"
+#include "InputException.h"
 
 class Operation;
 
+// The range of the maximum number of operations (asked at the start and by resize)
+constexpr int MIN_OPERATIONS = 2;
+constexpr int MAX_OPERATIONS = 1000000;
+
 
 class FunctionCalculator
 {
 public:
+    // What the script mode does when a command fails
+    enum class ErrorPolicy
+    {
+        Abort, // print the error and stop
+        Skip,  // go on, silently
+        Log,   // print the error and go on
+    };
+
     FunctionCalculator(std::ostream& ostr);
     void run();
     void run(std::istream& istr, bool fileMode);
+    // Runs commands separated by ';' without the menu and the prompts (the
+    // command line mode); stops at the first error and returns false
+    bool run(const std::string& commands);
+    // Runs the commands of istr, one per line with the matrices of eval on
+    // the lines after it, without the menu, the prompts or any question (the
+    // script mode). A read inside the script runs as a script too. Returns
+    // false if a command failed
+    bool runScript(std::istream& istr, ErrorPolicy policy);
 
 private:
     void eval(std::istringstream&, std::istream&);
+    // eval on matrices of element type E
+    template <typename E>
+    void evalAs(const Operation& operation, int size, std::istream& istr);
+    void beval(std::istringstream&);
+    void convert(std::istringstream&);
     void del(std::istringstream&);
     void help();
     void exit();
     void read(std::istringstream&);
     void resize(std::istream&);
+    void cache(std::istringstream&);
+    void threads(std::istringstream&);
+    void echo(std::istringstream&);
+    void stats(std::istringstream&);
 
     template <typename FuncType>
     void binaryFunc(std::istringstream& iss)
     {
         if (auto f0 = readOperationIndex(iss), f1 = readOperationIndex(iss); f0 && f1)
         {
-            addOperation(std::make_shared<FuncType>(m_operations[*f0], m_operations[*f1]));
+            addOperation(m_nodes.combine<FuncType>(m_operations[static_cast<std::size_t>(*f0)], m_operations[static_cast<std::size_t>(*f1)]));
         }
     }
 
     template <typename FuncType>
     void unaryFunc()
     {
-        addOperation(std::make_shared<FuncType>());
+        addOperation(m_nodes.emplace<FuncType>());
     }
 
     template <typename FuncType>
@@ -52,7 +85,22 @@ private:
         {
             throw std::runtime_error("Invalid input: expected an integer.");
         }
-        addOperation(std::make_shared<FuncType>(i));
+        addOperation(m_nodes.emplace<FuncType>(i));
+    }
+
+    // pow num k
+    void powFunc(std::istringstream& iss);
+
+    // FuncType applied to the result of operation #num (det num, inv num)
+    template <typename FuncType>
+    void factoredFunc(std::istringstream& iss)
+    {
+        if (auto index = readOperationIndex(iss); index)
+        {
+            if (hasNonWhitespace(iss))
+                throw InputException("Too many arguments for this command");
+            addOperation(m_nodes.apply<FuncType>(m_operations[static_cast<std::size_t>(*index)]));
+        }
     }
 
     void printOperations() const;
@@ -61,6 +109,8 @@ private:
     {
         Invalid,
         Eval,
+        BatchEval,
+        Convert,
         Iden,
         Tran,
         Scal,
@@ -68,11 +118,19 @@ private:
         Add,
         Mul,
         Comp,
+        Pow,
+        Det,
+        Inv,
+        Solve,
         Del,
         Help,
         Exit,
         Read,
-        Resize
+        Resize,
+        Cache,
+        Threads,
+        Echo,
+        Stats
     };
 
     // Command line
@@ -84,11 +142,18 @@ private:
     };
 
     using ActionMap = std::vector<ActionDetails>;
-    using OperationList = std::vector<std::shared_ptr<Operation>>;
+    // the numbered list of the user; the nodes are in m_nodes
+    using OperationList = std::vector<OperationHandle>;
 
     const ActionMap m_actions;
+    OperationPool m_nodes; // every operation is interned, so identical ones are one node
     OperationList m_operations;
+    EvalCache m_cache; // results of shared sub-operations (see Program)
+    std::unique_ptr<ThreadPool> m_pool; // runs independent branches of an eval, none - one thread
     bool m_running = true;
+    std::optional<ErrorPolicy> m_script; // set while a script runs
+    bool m_scriptFailed = false; // a script it read had errors
+    bool m_echoInputs = true; // eval prints its input matrices before the result
     //std::istream& m_istr;
     std::ostream& m_ostr;
 	int m_maxOperation = 3; // number of operations are leagelly
@@ -105,9 +170,11 @@ private:
     void runAction(Action action , std::istringstream&, std::istream&);
 
     ActionMap createActions() const;
-    OperationList createOperations() const ;
+    OperationList createOperations();
 
     bool hasNonWhitespace(std::istringstream&);
     void updateMaxFunc();
-    void addOperation(std::shared_ptr<Operation>);
+    // appends op to the list, or releases it if the list is full
+    void addOperation(OperationHandle op);
+    void removeOperations(std::size_t from, std::size_t to);
 };
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstddef>
+#include <cassert>
+
+
+// A non-owning view of the input matrices passed to Operation::compute.
+//
+// It is a contiguous range of the caller's matrices (a std::span), optionally
+// preceded by one more matrix: a composition passes the result of its first
+// operation in front of the inputs that are left. Slicing off the inputs of
+// a child (drop) never copies a matrix.
+template <typename M>
+class InputView
+{
+public:
+    InputView(std::span<const M> rest) : m_front(nullptr), m_rest(rest) {}
+    InputView(const std::vector<M>& all) : InputView(std::span<const M>(all)) {}
+
+    // front followed by rest; rest must not have a front of its own
+    InputView(const M& front, const InputView& rest) : m_front(&front), m_rest(rest.m_rest)
+    {
+        assert(rest.m_front == nullptr);
+    }
+
+    std::size_t size() const { return m_rest.size() + (m_front ? 1 : 0); }
+
+    const M& front() const { return m_front ? *m_front : m_rest.front(); }
+
+    const M& operator[](std::size_t i) const
+    {
+        if (m_front)
+            return i == 0 ? *m_front : m_rest[i - 1];
+        return m_rest[i];
+    }
+
+    // the view without its first count matrices
+    InputView drop(std::size_t count) const
+    {
+        if (m_front && count > 0)
+            return InputView(m_rest.subspan(count - 1));
+        return InputView(m_rest.subspan(count));
+    }
+
+private:
+    const M* m_front;
+    std::span<const M> m_rest;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "FactoredOperation.h"
+
+
+// base^-1: exact for integral matrices, so it fails unless the inverse is an
+// integer matrix in the window (see LuFactorization)
+class Inverse : public FactoredOperation
+{
+public:
+    using FactoredOperation::FactoredOperation;
+
+protected:
+    T result(const LuFactorization<int>& factorization) const override;
+    Program::OpCode code() const override;
+    const char* name() const override;
+};
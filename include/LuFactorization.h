@@ -0,0 +1,283 @@
+#pragma once
+
+#include "SquareMatrix.h"
+#include "ModularLu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// P A = L U with partial pivoting, the factorization behind det, inv and
+// solve. It is computed once per matrix and eval and shared: Program::run
+// keeps it in its EvalCache, keyed by the digest of the matrix, until the
+// eval ends.
+//
+// A floating point matrix is factored in its own type. An integral matrix is
+// factored exactly, modulo primes (see ModularLu), so det is exact and an
+// inverse or solution is a matrix of the element type only if all its values
+// are integers in the window (otherwise the first other value, e.g. 1/3, is
+// invalid).
+//
+// L (unit diagonal, not stored) and U share one contiguous SquareMatrix,
+// factored by blocks of LU_BLOCK columns: the panel of a block is eliminated
+// on its own, then the rows of the block right of it get a triangular solve
+// and the trailing matrix below gets the whole block in one product
+// (kernels::subtractProducts), so its rows are streamed once per block
+// instead of once per column. Every value still gets its updates in the
+// order of the columns, so the result is the same as unblocked. The
+// substitutions of solve and inverse go by blocks of rows the same way.
+inline constexpr int LU_BLOCK = 32;
+
+template <typename E, bool Exact = std::is_integral_v<E>>
+class LuFactorization
+{
+public:
+    using Scalar = E;
+    using Work = SquareMatrix<Scalar, UncheckedRange>;
+
+    // block: columns per block (LU_BLOCK, or the size for the unblocked form)
+    explicit LuFactorization(const SquareMatrix<E>& matrix, int block = LU_BLOCK);
+
+    int size() const { return m_lu.size(); }
+    bool singular() const { return m_singular; }
+
+    // det(A) * I: an operation result is a matrix of the size of its input
+    SquareMatrix<E> determinant() const;
+    // A^-1, and A^-1 rhs; a FileException if A is singular
+    SquareMatrix<E> inverse() const;
+    SquareMatrix<E> solve(const SquareMatrix<E>& rhs) const;
+
+private:
+    // Subtracts factor * source from the values [begin, end) of target
+    // (factor by value: a reference into target would keep the loop scalar)
+    static void subtractRow(Scalar* target, const Scalar* source, Scalar factor, int begin, int end);
+    // c[i][j] -= a[i][k] * b[k][j] for rows [i0, i1), depth [k0, k1), columns [j0, j1)
+    static void subtractProducts(const Work& a, const Work& b, Work& c, int i0, int i1, int k0, int k1, int j0, int j1);
+
+    void factorBlock(int begin, int end);
+    // Overwrites rows (P rhs, in place) with U^-1 L^-1 P rhs
+    void substitute(Work& rows) const;
+    static E result(const Scalar& value);
+    static SquareMatrix<E> result(const Work& values);
+
+    Work m_lu;
+    std::vector<int> m_pivots; // row k was swapped with row m_pivots[k] >= k
+    bool m_negative = false; // odd number of swaps
+    bool m_singular = false;
+};
+
+// The exact form, for the integral element types
+template <typename E>
+class LuFactorization<E, true>
+{
+public:
+    explicit LuFactorization(const SquareMatrix<E>& matrix, int block = LU_BLOCK)
+        : m_lu(std::vector<std::int64_t>(matrix.data(), matrix.data() + matrix.count()), matrix.size(), block)
+    {
+    }
+
+    int size() const { return m_lu.size(); }
+    bool singular() const { return m_lu.singular(); }
+
+    SquareMatrix<E> determinant() const
+    {
+        auto result = SquareMatrix<E>(size(), E());
+        const auto value = static_cast<E>(m_lu.determinant());
+        for (int i = 0; i < size(); ++i)
+            result(i, i) = value;
+        return result;
+    }
+
+    SquareMatrix<E> inverse() const
+    {
+        auto identity = std::vector<std::int64_t>(static_cast<std::size_t>(size()) * static_cast<std::size_t>(size()), 0);
+        for (int i = 0; i < size(); ++i)
+            identity[static_cast<std::size_t>(i) * static_cast<std::size_t>(size() + 1)] = 1;
+        return result(m_lu.solve(identity));
+    }
+
+    SquareMatrix<E> solve(const SquareMatrix<E>& rhs) const
+    {
+        return result(m_lu.solve(std::vector<std::int64_t>(rhs.data(), rhs.data() + rhs.count())));
+    }
+
+private:
+    SquareMatrix<E> result(const std::vector<std::int64_t>& values) const
+    {
+        auto matrix = SquareMatrix<E>(size(), typename SquareMatrix<E>::NoFill());
+        std::transform(values.begin(), values.end(), matrix.data(), [](std::int64_t value) { return static_cast<E>(value); });
+        return matrix;
+    }
+
+    ModularLu m_lu;
+};
+
+
+template <typename E, bool Exact>
+LuFactorization<E, Exact>::LuFactorization(const SquareMatrix<E>& matrix, int block)
+    : m_lu(matrix.size(), Scalar()), m_pivots(static_cast<std::size_t>(matrix.size()))
+{
+    std::copy(matrix.data(), matrix.data() + matrix.count(), m_lu.data());
+    for (int begin = 0; begin < size(); begin += block)
+        factorBlock(begin, std::min(begin + block, size()));
+}
+
+template <typename E, bool Exact>
+void LuFactorization<E, Exact>::factorBlock(int begin, int end)
+{
+    const int n = size();
+
+    // the panel: columns [begin, end) of the rows below begin
+    for (int k = begin; k < end; ++k)
+    {
+        int pivot = k;
+        for (int i = k + 1; i < n; ++i)
+            if (std::abs(m_lu(i, k)) > std::abs(m_lu(pivot, k)))
+                pivot = i;
+        m_pivots[static_cast<std::size_t>(k)] = pivot;
+        if (pivot != k)
+        {
+            std::swap_ranges(m_lu.row(k), m_lu.row(k) + n, m_lu.row(pivot));
+            m_negative = !m_negative;
+        }
+        if (m_lu(k, k) == Scalar())
+        {
+            // the column is zero below the diagonal already
+            m_singular = true;
+            continue;
+        }
+        for (int i = k + 1; i < n; ++i)
+        {
+            if (m_lu(i, k) == Scalar())
+                continue;
+            m_lu(i, k) /= m_lu(k, k);
+            subtractRow(m_lu.row(i), m_lu.row(k), m_lu(i, k), k + 1, end);
+        }
+    }
+
+    // the rows of the block right of it: U12 = L11^-1 A12
+    for (int i = begin + 1; i < end; ++i)
+    {
+        for (int k = begin; k < i; ++k)
+        {
+            if (m_lu(i, k) != Scalar())
+                subtractRow(m_lu.row(i), m_lu.row(k), m_lu(i, k), end, n);
+        }
+    }
+    // the trailing matrix: A22 -= L21 U12
+    subtractProducts(m_lu, m_lu, m_lu, end, n, begin, end, end, n);
+}
+
+template <typename E, bool Exact>
+SquareMatrix<E> LuFactorization<E, Exact>::determinant() const
+{
+    auto det = m_negative ? -Scalar(1) : Scalar(1);
+    for (int i = 0; i < size(); ++i)
+        det = det * m_lu(i, i);
+
+    auto result = SquareMatrix<E>(size(), E());
+    const auto value = LuFactorization::result(det);
+    for (int i = 0; i < size(); ++i)
+        result(i, i) = value;
+    return result;
+}
+
+template <typename E, bool Exact>
+SquareMatrix<E> LuFactorization<E, Exact>::inverse() const
+{
+    auto rows = Work(size(), Scalar());
+    for (int i = 0; i < size(); ++i)
+        rows(i, i) = Scalar(1);
+    substitute(rows);
+    return result(rows);
+}
+
+template <typename E, bool Exact>
+SquareMatrix<E> LuFactorization<E, Exact>::solve(const SquareMatrix<E>& rhs) const
+{
+    auto rows = Work(size(), Scalar());
+    std::copy(rhs.data(), rhs.data() + rhs.count(), rows.data());
+    substitute(rows);
+    return result(rows);
+}
+
+template <typename E, bool Exact>
+void LuFactorization<E, Exact>::substitute(Work& rows) const
+{
+    if (m_singular)
+        throw FileException("the matrix is singular");
+
+    const int n = size();
+    for (int k = 0; k < n; ++k)
+    {
+        const int pivot = m_pivots[static_cast<std::size_t>(k)];
+        if (pivot != k)
+            std::swap_ranges(rows.row(k), rows.row(k) + n, rows.row(pivot));
+    }
+
+    // L^-1, then U^-1, by blocks of rows: the rows already solved are
+    // subtracted from a block in one product, then the block is solved row
+    // by row; every pass reads and writes whole rows
+    for (int begin = 0; begin < n; begin += LU_BLOCK)
+    {
+        const int end = std::min(begin + LU_BLOCK, n);
+        subtractProducts(m_lu, rows, rows, begin, end, 0, begin, 0, n);
+        for (int i = begin + 1; i < end; ++i)
+        {
+            for (int k = begin; k < i; ++k)
+            {
+                if (m_lu(i, k) != Scalar())
+                    subtractRow(rows.row(i), rows.row(k), m_lu(i, k), 0, n);
+            }
+        }
+    }
+    for (int end = n; end > 0; end -= LU_BLOCK)
+    {
+        const int begin = std::max(end - LU_BLOCK, 0);
+        subtractProducts(m_lu, rows, rows, begin, end, end, n, 0, n);
+        for (int i = end - 1; i >= begin; --i)
+        {
+            for (int k = i + 1; k < end; ++k)
+            {
+                if (m_lu(i, k) != Scalar())
+                    subtractRow(rows.row(i), rows.row(k), m_lu(i, k), 0, n);
+            }
+            const auto pivot = m_lu(i, i);
+            for (int j = 0; j < n; ++j)
+                rows(i, j) /= pivot;
+        }
+    }
+}
+
+template <typename E, bool Exact>
+void LuFactorization<E, Exact>::subtractRow(Scalar* target, const Scalar* source, Scalar factor, int begin, int end)
+{
+    for (int j = begin; j < end; ++j)
+        target[j] -= factor * source[j];
+}
+
+template <typename E, bool Exact>
+void LuFactorization<E, Exact>::subtractProducts(const Work& a, const Work& b, Work& c, int i0, int i1, int k0, int k1, int j0, int j1)
+{
+    kernels::subtractProducts(c.size(), a.data(), b.data(), c.data(), i0, i1, k0, k1, j0, j1);
+}
+
+template <typename E, bool Exact>
+E LuFactorization<E, Exact>::result(const Scalar& value)
+{
+    SquareMatrix<E>::checkVal(value);
+    return value;
+}
+
+template <typename E, bool Exact>
+SquareMatrix<E> LuFactorization<E, Exact>::result(const Work& values)
+{
+    auto matrix = SquareMatrix<E>(values.size(), E());
+    for (std::size_t i = 0; i < values.count(); ++i)
+        matrix.data()[i] = result(values.data()[i]);
+    return matrix;
+}
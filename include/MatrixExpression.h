@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <optional>
+#include <concepts>
+#include <type_traits>
+
+#include "RangePolicy.h"
+
+
+// Expression templates for the element-wise SquareMatrix arithmetic.
+//
+// a + b, a - b and a * scalar do not compute anything; they return small
+// expression objects that refer to their operands. The whole tree is
+// evaluated when it is assigned to a SquareMatrix, in one pass over the
+// destination, TILE elements at a time: every node computes its tile into a
+// buffer on the stack (with the SIMD kernels), so the intermediate values
+// stay in L1 instead of being written to full size temporaries.
+//
+// Range checks keep their eager meaning: each intermediate node checks its
+// own values. The fused pass only collects an "all valid" flag; if it is
+// cleared the tree is re-evaluated eagerly (materialize()), node by node in
+// the old order, which applies the range policy (see RangePolicy.h) of
+// every intermediate as an eager evaluation would - for ThrowingRange, the
+// same FileException as before. With UncheckedRange the tiles are computed
+// by the plain kernels.
+
+constexpr std::size_t MATRIX_EXPRESSION_TILE = 1024;
+
+template <typename E>
+class MatrixExpression
+{
+public:
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+template <typename E>
+concept MatrixExpressionType = std::derived_from<E, MatrixExpression<E>>;
+
+
+// Leaf: a matrix that is read directly, optionally transposed and optionally
+// multiplied by a (checked) scalar. Also used by the operations to hand over
+// their input without copying it (see Operation::term).
+template <typename T, typename P = ThrowingRange>
+class MatrixTerm : public MatrixExpression<MatrixTerm<T, P>>
+{
+public:
+    using value_type = T;
+    using policy_type = P;
+
+    explicit MatrixTerm(const SquareMatrix<T, P>& source, bool transposed = false, std::optional<T> scale = std::nullopt)
+        : m_source(&source), m_transposed(transposed), m_scale(scale) {}
+
+    int size() const { return m_source->size(); }
+    const SquareMatrix<T, P>& source() const { return *m_source; }
+    bool transposed() const { return m_transposed; }
+    const std::optional<T>& scale() const { return m_scale; }
+
+    // The scale is the only part of a term that can produce invalid values
+    bool checked() const { return m_scale.has_value(); }
+
+    const T* tile(std::size_t begin, std::size_t length, T* buffer, bool& valid) const;
+    SquareMatrix<T, P> materialize() const;
+    // the range report of the leaves, in evaluation order
+    typename P::Report report() const { return m_source->report(); }
+
+private:
+    const SquareMatrix<T, P>* m_source;
+    bool m_transposed;
+    std::optional<T> m_scale;
+};
+
+template <typename L, typename R, bool Subtract>
+class MatrixSum : public MatrixExpression<MatrixSum<L, R, Subtract>>
+{
+public:
+    using value_type = typename L::value_type;
+    using policy_type = typename L::policy_type;
+    static_assert(std::is_same_v<policy_type, typename R::policy_type>, "the operands must have the same range policy");
+
+    MatrixSum(const L& lhs, const R& rhs) : m_lhs(lhs), m_rhs(rhs) {}
+
+    int size() const { return m_lhs.size(); }
+
+    const value_type* tile(std::size_t begin, std::size_t length, value_type* buffer, bool& valid) const
+    {
+        value_type lhsBuffer[MATRIX_EXPRESSION_TILE];
+        value_type rhsBuffer[MATRIX_EXPRESSION_TILE];
+        const auto* a = m_lhs.tile(begin, length, lhsBuffer, valid);
+        const auto* b = m_rhs.tile(begin, length, rhsBuffer, valid);
+        if constexpr (!policy_type::checks && Subtract)
+            kernels::sub(a, b, buffer, length);
+        else if constexpr (!policy_type::checks)
+            kernels::add(a, b, buffer, length);
+        else if constexpr (Subtract)
+            valid &= kernels::subInRange(a, b, buffer, length, value_type(MIN_ALLOWED_VALU), value_type(MAX_ALLOWED_VALUE));
+        else
+            valid &= kernels::addInRange(a, b, buffer, length, value_type(MIN_ALLOWED_VALU), value_type(MAX_ALLOWED_VALUE));
+        return buffer;
+    }
+
+    SquareMatrix<value_type, policy_type> materialize() const
+    {
+        using Matrix = SquareMatrix<value_type, policy_type>;
+        const auto a = m_lhs.materialize();
+        const auto b = m_rhs.materialize();
+        return Subtract ? Matrix::sub(a, b) : Matrix::add(a, b);
+    }
+
+    typename policy_type::Report report() const
+    {
+        auto result = m_lhs.report();
+        result.merge(m_rhs.report());
+        return result;
+    }
+
+private:
+    L m_lhs;
+    R m_rhs;
+};
+
+template <typename E>
+class MatrixScaled : public MatrixExpression<MatrixScaled<E>>
+{
+public:
+    using value_type = typename E::value_type;
+    using policy_type = typename E::policy_type;
+
+    MatrixScaled(const E& expr, const value_type& scalar) : m_expr(expr), m_scalar(scalar) {}
+
+    int size() const { return m_expr.size(); }
+
+    const value_type* tile(std::size_t begin, std::size_t length, value_type* buffer, bool& valid) const
+    {
+        const auto* a = m_expr.tile(begin, length, buffer, valid);
+        if constexpr (policy_type::checks)
+            valid &= kernels::scaleInRange(a, m_scalar, buffer, length, value_type(MIN_ALLOWED_VALU), value_type(MAX_ALLOWED_VALUE));
+        else
+            kernels::scale(a, m_scalar, buffer, length);
+        return buffer;
+    }
+
+    SquareMatrix<value_type, policy_type> materialize() const
+    {
+        return SquareMatrix<value_type, policy_type>::scale(m_expr.materialize(), m_scalar);
+    }
+
+    typename policy_type::Report report() const { return m_expr.report(); }
+
+private:
+    E m_expr;
+    value_type m_scalar;
+};
+
+
+// Builds the expression nodes from matrices and other expressions
+
+template <typename T, typename P>
+MatrixTerm<T, P> toExpression(const SquareMatrix<T, P>& matrix) { return MatrixTerm<T, P>(matrix); }
+
+template <MatrixExpressionType E>
+const E& toExpression(const E& expr) { return expr; }
+
+template <typename A>
+struct IsSquareMatrix : std::false_type {};
+
+template <typename T, typename P>
+struct IsSquareMatrix<SquareMatrix<T, P>> : std::true_type {};
+
+template <typename A>
+concept MatrixOperand = MatrixExpressionType<A> || IsSquareMatrix<A>::value;
+
+template <MatrixOperand L, MatrixOperand R>
+auto operator+(const L& lhs, const R& rhs)
+{
+    using LE = std::remove_cvref_t<decltype(toExpression(lhs))>;
+    using RE = std::remove_cvref_t<decltype(toExpression(rhs))>;
+    return MatrixSum<LE, RE, false>(toExpression(lhs), toExpression(rhs));
+}
+
+template <MatrixOperand L, MatrixOperand R>
+auto operator-(const L& lhs, const R& rhs)
+{
+    using LE = std::remove_cvref_t<decltype(toExpression(lhs))>;
+    using RE = std::remove_cvref_t<decltype(toExpression(rhs))>;
+    return MatrixSum<LE, RE, true>(toExpression(lhs), toExpression(rhs));
+}
+
+template <MatrixOperand L>
+auto operator*(const L& lhs, const typename std::remove_cvref_t<decltype(toExpression(lhs))>::value_type& scalar)
+{
+    using LE = std::remove_cvref_t<decltype(toExpression(lhs))>;
+    return MatrixScaled<LE>(toExpression(lhs), scalar);
+}
+
+
+template <typename T, typename P>
+const T* MatrixTerm<T, P>::tile(std::size_t begin, std::size_t length, T* buffer, bool& valid) const
+{
+    const T* values = m_source->data() + begin;
+    if (m_transposed)
+    {
+        // walk the tile row segment by row segment; element (i, j) is read from (j, i)
+        const auto n = static_cast<std::size_t>(m_source->size());
+        auto i = begin / n;
+        auto j = begin % n;
+        for (std::size_t k = 0; k < length; ++i, j = 0)
+        {
+            const auto end = std::min(n, j + (length - k));
+            for (; j < end; ++j, ++k)
+                buffer[k] = m_source->data()[j * n + i];
+        }
+        values = buffer;
+    }
+    if (m_scale)
+    {
+        if constexpr (P::checks)
+            valid &= kernels::scaleInRange(values, *m_scale, buffer, length, T(MIN_ALLOWED_VALU), T(MAX_ALLOWED_VALUE));
+        else
+            kernels::scale(values, *m_scale, buffer, length);
+        values = buffer;
+    }
+    return values;
+}
+
+template <typename T, typename P>
+SquareMatrix<T, P> MatrixTerm<T, P>::materialize() const
+{
+    auto result = m_transposed ? m_source->Transpose() : *m_source;
+    return m_scale ? SquareMatrix<T, P>::scale(result, *m_scale) : result;
+}
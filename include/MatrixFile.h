@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MatrixView.h"
+#include "SquareMatrix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <iosfwd>
+#include <vector>
+
+// Every payload of a matrix file starts at a multiple of this many bytes
+constexpr std::size_t MATRIX_FILE_ALIGNMENT = 64;
+// beval writes its results as a matrix file when outfile has this extension
+const std::string MATRIX_FILE_EXTENSION = ".bin";
+
+
+// The binary matrix file: a 64 byte header, then count payloads of size x
+// size elements in row-major order (the layout of SquareMatrix), each one
+// starting at a multiple of MATRIX_FILE_ALIGNMENT. Numbers are stored in the
+// byte order of the machine that wrote the file.
+struct MatrixFileHeader
+{
+    static constexpr char Magic[8] = { 'O', 'O', 'P', '2', 'M', 'A', 'T', '\0' };
+    static constexpr std::uint32_t Version = 1;
+
+    enum class ElementType : std::uint32_t
+    {
+        Int32 = 1,
+    };
+
+    char magic[8];
+    std::uint32_t version;
+    ElementType elementType;
+    std::uint32_t elementSize; // bytes per element
+    std::uint32_t size;        // of every matrix
+    std::uint64_t count;       // number of matrices
+    std::uint64_t stride;      // bytes from one payload to the next
+    std::uint8_t reserved[24];
+
+    // bytes of the payload of a size x size matrix, padded to the alignment
+    static std::uint64_t strideFor(std::uint32_t size);
+};
+static_assert(sizeof(MatrixFileHeader) == MATRIX_FILE_ALIGNMENT, "the payloads start right after the header");
+
+
+// A matrix file mapped into memory (read into a buffer where mmap is not
+// available). The matrices are views into the mapping: loading a file does
+// not parse or copy anything, and pages are read as the matrices are used.
+// An invalid or truncated file is a FileException.
+class MatrixFile
+{
+public:
+    explicit MatrixFile(const std::string& path);
+    ~MatrixFile();
+    MatrixFile(const MatrixFile&) = delete;
+    MatrixFile& operator=(const MatrixFile&) = delete;
+
+    // whether the file at path starts like a matrix file
+    static bool isMatrixFile(const std::string& path);
+
+    int size() const { return static_cast<int>(m_header.size); }
+    std::size_t count() const { return static_cast<std::size_t>(m_header.count); }
+    MatrixView<int> view(std::size_t i) const;
+
+    // Converts whitespace separated size x size matrices (the text read by
+    // eval and beval) into a matrix file; returns the number of matrices
+    static std::size_t fromText(std::istream& text, int size, const std::string& path);
+    // Writes the matrices of the file as text, separated by an empty line
+    std::size_t toText(std::ostream& text) const;
+
+private:
+    void unmap();
+
+    const std::byte* m_bytes = nullptr;
+    std::size_t m_length = 0;
+    MatrixFileHeader m_header{};
+#if defined(_WIN32)
+    std::vector<std::uint64_t> m_buffer;
+#endif
+};
+
+
+// Writes matrices of one size to a matrix file, one payload at a time; the
+// count in the header is filled in by finish() (or the destructor)
+class MatrixFileWriter
+{
+public:
+    MatrixFileWriter(const std::string& path, int size);
+    ~MatrixFileWriter();
+    MatrixFileWriter(const MatrixFileWriter&) = delete;
+    MatrixFileWriter& operator=(const MatrixFileWriter&) = delete;
+
+    void write(const MatrixView<int>& matrix);
+    void write(const SquareMatrix<int>& matrix) { write(MatrixView<int>(matrix.data(), matrix.size())); }
+
+    std::size_t count() const { return static_cast<std::size_t>(m_header.count); }
+    void finish();
+
+private:
+    std::string m_path;
+    std::ofstream m_file;
+    MatrixFileHeader m_header{};
+    bool m_finished = false;
+};
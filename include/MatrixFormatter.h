@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MatrixView.h"
+
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <vector>
+
+
+// Renders a whole matrix into one reusable char buffer with std::to_chars,
+// in the text layout of operator<< (every value followed by a space, every
+// row by a new line), so that it is written with one call instead of a
+// formatted write per value and separator. A float or double is written in
+// its shortest form that reads back as the same value.
+class MatrixFormatter
+{
+public:
+    // the text of matrix, valid until the next call
+    std::string_view format(const MatrixView<int>& matrix);
+    std::string_view format(const MatrixView<std::int64_t>& matrix);
+    std::string_view format(const MatrixView<float>& matrix);
+    std::string_view format(const MatrixView<double>& matrix);
+
+    template <typename T>
+    void write(std::ostream& ostr, const MatrixView<T>& matrix)
+    {
+        write(ostr, format(matrix));
+    }
+
+private:
+    template <typename T>
+    std::string_view render(const MatrixView<T>& matrix);
+    void write(std::ostream& ostr, std::string_view text);
+
+    std::vector<char> m_buffer;
+};
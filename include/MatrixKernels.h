@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+
+// Low level loops over the contiguous row-major storage of SquareMatrix.
+// They work on raw pointers and know nothing about range checking; the
+// SquareMatrix operators wrap them and validate the results.
+namespace kernels
+{
+    // Tile sizes of the blocked multiply: a KC x NC panel of b (128 KiB of
+    // int) stays in L2 while MC rows of a and c stream through L1
+    constexpr int GEMM_MC = 64;
+    constexpr int GEMM_KC = 128;
+    constexpr int GEMM_NC = 256;
+
+    // c[i][j] += sum_k a[i][k] * b[k][j] for rows [i0, i1), depth [k0, k1), columns [j0, j1).
+    // Four rows of c share every load of a row of b.
+    template <typename In, typename Acc>
+    void gemmTile(int n, const In* a, const In* b, Acc* c, int i0, int i1, int k0, int k1, int j0, int j1)
+    {
+        const auto stride = static_cast<std::size_t>(n);
+        auto i = i0;
+        for (; i + 4 <= i1; i += 4)
+        {
+            Acc* c0 = c + static_cast<std::size_t>(i) * stride;
+            Acc* c1 = c0 + stride;
+            Acc* c2 = c1 + stride;
+            Acc* c3 = c2 + stride;
+            const In* a0 = a + static_cast<std::size_t>(i) * stride;
+            for (int k = k0; k < k1; ++k)
+            {
+                const auto x0 = static_cast<Acc>(a0[k]);
+                const auto x1 = static_cast<Acc>(a0[stride + static_cast<std::size_t>(k)]);
+                const auto x2 = static_cast<Acc>(a0[2 * stride + static_cast<std::size_t>(k)]);
+                const auto x3 = static_cast<Acc>(a0[3 * stride + static_cast<std::size_t>(k)]);
+                const In* bk = b + static_cast<std::size_t>(k) * stride;
+                for (int j = j0; j < j1; ++j)
+                {
+                    const auto y = static_cast<Acc>(bk[j]);
+                    c0[j] += x0 * y;
+                    c1[j] += x1 * y;
+                    c2[j] += x2 * y;
+                    c3[j] += x3 * y;
+                }
+            }
+        }
+        for (; i < i1; ++i)
+        {
+            Acc* ci = c + static_cast<std::size_t>(i) * stride;
+            const In* ai = a + static_cast<std::size_t>(i) * stride;
+            for (int k = k0; k < k1; ++k)
+            {
+                const auto x = static_cast<Acc>(ai[k]);
+                const In* bk = b + static_cast<std::size_t>(k) * stride;
+                for (int j = j0; j < j1; ++j)
+                {
+                    ci[j] += x * static_cast<Acc>(bk[j]);
+                }
+            }
+        }
+    }
+
+    // c[i][j] -= a[i][k] * b[k][j] for rows [i0, i1), depth [k0, k1), columns
+    // [j0, j1), one product at a time in the order of k (the trailing update
+    // of LuFactorization). a and b may be c itself, if what they read is
+    // outside the block of c that is written.
+    template <typename T>
+    void subtractProductsTile(int n, const T* a, const T* b, T* c, int i0, int i1, int k0, int k1, int j0, int j1)
+    {
+        const auto stride = static_cast<std::size_t>(n);
+        auto i = i0;
+        for (; i + 4 <= i1; i += 4)
+        {
+            T* c0 = c + static_cast<std::size_t>(i) * stride;
+            T* c1 = c0 + stride;
+            T* c2 = c1 + stride;
+            T* c3 = c2 + stride;
+            const T* a0 = a + static_cast<std::size_t>(i) * stride;
+            for (int k = k0; k < k1; ++k)
+            {
+                const auto x0 = a0[k];
+                const auto x1 = a0[stride + static_cast<std::size_t>(k)];
+                const auto x2 = a0[2 * stride + static_cast<std::size_t>(k)];
+                const auto x3 = a0[3 * stride + static_cast<std::size_t>(k)];
+                const T* bk = b + static_cast<std::size_t>(k) * stride;
+                for (int j = j0; j < j1; ++j)
+                {
+                    const auto y = bk[j];
+                    c0[j] -= x0 * y;
+                    c1[j] -= x1 * y;
+                    c2[j] -= x2 * y;
+                    c3[j] -= x3 * y;
+                }
+            }
+        }
+        for (; i < i1; ++i)
+        {
+            T* ci = c + static_cast<std::size_t>(i) * stride;
+            const T* ai = a + static_cast<std::size_t>(i) * stride;
+            for (int k = k0; k < k1; ++k)
+            {
+                const auto x = ai[k];
+                const T* bk = b + static_cast<std::size_t>(k) * stride;
+                for (int j = j0; j < j1; ++j)
+                {
+                    ci[j] -= x * bk[j];
+                }
+            }
+        }
+    }
+
+    // c = a * b for n x n row-major matrices; c must hold n * n elements and is overwritten
+    template <typename In, typename Acc>
+    void gemm(int n, const In* a, const In* b, Acc* c)
+    {
+        std::fill(c, c + static_cast<std::size_t>(n) * static_cast<std::size_t>(n), Acc{});
+        for (int jj = 0; jj < n; jj += GEMM_NC)
+        {
+            const auto jEnd = std::min(jj + GEMM_NC, n);
+            for (int kk = 0; kk < n; kk += GEMM_KC)
+            {
+                const auto kEnd = std::min(kk + GEMM_KC, n);
+                for (int ii = 0; ii < n; ii += GEMM_MC)
+                {
+                    gemmTile(n, a, b, c, ii, std::min(ii + GEMM_MC, n), kk, kEnd, jj, jEnd);
+                }
+            }
+        }
+    }
+
+    // Edge of the square tiles of the transposes: a tile of int is 4 KiB, so
+    // the source and destination tiles are both in L1 while it is copied
+    constexpr int TRANSPOSE_BLOCK = 32;
+
+    // dst = transpose of src for n x n row-major matrices (dst must not alias src).
+    // Tile by tile: a tile of src is copied row by row to a buffer and
+    // written to dst row by row, so only the buffer (in L1) is read with a
+    // stride. Strided reads of the matrix itself would hit the same few
+    // cache sets when n is a power of two.
+    template <typename T>
+    void transpose(int n, const T* src, T* dst)
+    {
+        const auto stride = static_cast<std::size_t>(n);
+        constexpr auto B = static_cast<std::size_t>(TRANSPOSE_BLOCK);
+        T tile[B * B];
+        for (int i0 = 0; i0 < n; i0 += TRANSPOSE_BLOCK)
+        {
+            const auto rows = static_cast<std::size_t>(std::min(n, i0 + TRANSPOSE_BLOCK) - i0);
+            for (int j0 = 0; j0 < n; j0 += TRANSPOSE_BLOCK)
+            {
+                const auto cols = static_cast<std::size_t>(std::min(n, j0 + TRANSPOSE_BLOCK) - j0);
+                // rows j0.. of src become columns j0.. of dst
+                for (std::size_t c = 0; c < cols; ++c)
+                    std::copy_n(src + (static_cast<std::size_t>(j0) + c) * stride + static_cast<std::size_t>(i0), rows, tile + c * B);
+                for (std::size_t r = 0; r < rows; ++r)
+                {
+                    T* out = dst + (static_cast<std::size_t>(i0) + r) * stride + static_cast<std::size_t>(j0);
+                    for (std::size_t c = 0; c < cols; ++c)
+                        out[c] = tile[c * B + r];
+                }
+            }
+        }
+    }
+
+    // Transposes the n x n row-major matrix a in place. Each tile above the
+    // diagonal and its mirror below it are copied row by row to two buffers
+    // and written back transposed, so only the buffers (in L1) are read
+    // with a stride; the tiles on the diagonal are transposed as they are.
+    template <typename T>
+    void transposeInPlace(int n, T* a)
+    {
+        const auto stride = static_cast<std::size_t>(n);
+        const auto at = [&](int i, int j) -> T& { return a[static_cast<std::size_t>(i) * stride + static_cast<std::size_t>(j)]; };
+        constexpr auto B = static_cast<std::size_t>(TRANSPOSE_BLOCK);
+        T upper[B * B];
+        T lower[B * B];
+
+        for (int i0 = 0; i0 < n; i0 += TRANSPOSE_BLOCK)
+        {
+            const auto i1 = std::min(n, i0 + TRANSPOSE_BLOCK);
+            for (int i = i0; i < i1; ++i)
+                for (int j = i + 1; j < i1; ++j)
+                    std::swap(at(i, j), at(j, i));
+
+            for (int j0 = i1; j0 < n; j0 += TRANSPOSE_BLOCK)
+            {
+                const auto j1 = std::min(n, j0 + TRANSPOSE_BLOCK);
+                const auto rows = static_cast<std::size_t>(i1 - i0);
+                const auto cols = static_cast<std::size_t>(j1 - j0);
+                for (std::size_t r = 0; r < rows; ++r)
+                    std::copy_n(&at(i0 + static_cast<int>(r), j0), cols, upper + r * B);
+                for (std::size_t c = 0; c < cols; ++c)
+                    std::copy_n(&at(j0 + static_cast<int>(c), i0), rows, lower + c * B);
+
+                for (std::size_t r = 0; r < rows; ++r)
+                {
+                    T* out = &at(i0 + static_cast<int>(r), j0);
+                    for (std::size_t c = 0; c < cols; ++c)
+                        out[c] = lower[c * B + r];
+                }
+                for (std::size_t c = 0; c < cols; ++c)
+                {
+                    T* out = &at(j0 + static_cast<int>(c), i0);
+                    for (std::size_t r = 0; r < rows; ++r)
+                        out[r] = upper[r * B + c];
+                }
+            }
+        }
+    }
+
+    // Smallest and largest value in [data, data + count), computed without branches
+    template <typename T>
+    void minMax(const T* data, std::size_t count, T& lo, T& hi)
+    {
+        lo = count ? data[0] : T{};
+        hi = lo;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            lo = std::min(lo, data[i]);
+            hi = std::max(hi, data[i]);
+        }
+    }
+
+    // Element-wise kernels without range checks (UncheckedRange). Integral
+    // values are computed in the unsigned type, so overflow wraps around
+    // instead of being undefined.
+    template <typename T>
+    auto wrapping(const T& val)
+    {
+        if constexpr (std::is_integral_v<T>)
+            return static_cast<std::make_unsigned_t<T>>(val);
+        else
+            return val;
+    }
+
+    template <typename T>
+    void add(const T* a, const T* b, T* out, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = static_cast<T>(wrapping(a[i]) + wrapping(b[i]));
+    }
+
+    template <typename T>
+    void sub(const T* a, const T* b, T* out, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = static_cast<T>(wrapping(a[i]) - wrapping(b[i]));
+    }
+
+    template <typename T>
+    void scale(const T* a, T scalar, T* out, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+            out[i] = static_cast<T>(wrapping(a[i]) * wrapping(scalar));
+    }
+
+    // Generic versions of the element-wise kernels in SimdKernels.h, used for
+    // element types other than int. Same contract: no branch per element, and
+    // false when some result lies outside the open interval (lo, hi).
+    template <typename T>
+    bool addInRange(const T* a, const T* b, T* out, std::size_t count, T lo, T hi)
+    {
+        bool bad = false;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = a[i] + b[i];
+            bad |= (out[i] <= lo) | (out[i] >= hi);
+        }
+        return !bad;
+    }
+
+    template <typename T>
+    bool subInRange(const T* a, const T* b, T* out, std::size_t count, T lo, T hi)
+    {
+        bool bad = false;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = a[i] - b[i];
+            bad |= (out[i] <= lo) | (out[i] >= hi);
+        }
+        return !bad;
+    }
+
+    template <typename T>
+    bool scaleInRange(const T* a, T scalar, T* out, std::size_t count, T lo, T hi)
+    {
+        bool bad = false;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            out[i] = a[i] * scalar;
+            bad |= (out[i] <= lo) | (out[i] >= hi);
+        }
+        return !bad;
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Bytes MatrixParser reads at a time from a stream it may consume to the end
+constexpr std::size_t MATRIX_PARSER_CHUNK = std::size_t(1) << 16;
+
+
+// Reads whitespace separated values (int, std::int64_t, float or double)
+// straight into matrix storage, with std::from_chars over a buffer instead
+// of a formatted (locale aware) read per value.
+//
+// In Stream mode the input is read in MATRIX_PARSER_CHUNK blocks, so the
+// parser owns the rest of the stream. In Lines mode it reads one line at a
+// time and never past the line of the last value it needs: the stream can
+// be a console, or a file of commands with the matrices between them.
+// Whatever is left of the last line read goes away with the parser.
+//
+// Errors are FileExceptions that start with the line and column of the
+// offending text, counted from where the parser started.
+class MatrixParser
+{
+public:
+    enum class Mode
+    {
+        Stream,
+        Lines,
+    };
+
+    MatrixParser(std::istream& istr, Mode mode);
+
+    // Parses count values into out. Unless checkRange is false, a value out
+    // of (MIN_ALLOWED_VALU, MAX_ALLOWED_VALUE) is an error too
+    void read(int* out, std::size_t count, bool checkRange = true);
+    void read(std::int64_t* out, std::size_t count, bool checkRange = true);
+    void read(float* out, std::size_t count, bool checkRange = true);
+    void read(double* out, std::size_t count, bool checkRange = true);
+
+    template <typename T, typename Policy>
+    void read(SquareMatrix<T, Policy>& matrix, bool checkRange = true)
+    {
+        read(matrix.data(), matrix.count(), checkRange);
+    }
+
+    // Skips whitespace; true if there is nothing else in the input
+    bool atEnd();
+
+    // position of the next character, from 1
+    long long line() const { return m_line; }
+    long long column() const { return static_cast<long long>(m_offset + m_begin - m_lineStart) + 1; }
+
+private:
+    template <typename T>
+    void readValues(T* out, std::size_t count, bool checkRange);
+
+    // more input after m_begin; false at the end of the input
+    bool refill();
+    // in Stream mode, at least a whole token after m_begin unless the input ends first
+    void ensureToken();
+    // the text of the token at m_begin, for a message
+    std::string token() const;
+    std::string where() const;
+
+    std::istream& m_istr;
+    Mode m_mode;
+    std::vector<char> m_buffer;
+    std::size_t m_begin = 0; // next character
+    std::size_t m_end = 0;   // end of the characters read
+    bool m_eof = false;
+
+    long long m_line = 1;
+    std::size_t m_offset = 0;    // characters of the input before m_buffer[0]
+    std::size_t m_lineStart = 0; // input offset of the first character of the line
+    std::string m_text;          // Lines mode: the line being read
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+// Bytes of free buffers every thread keeps for reuse
+constexpr std::size_t MATRIX_POOL_MAX_BYTES = std::size_t(16) << 20;
+// Larger buffers (a 1024 x 1024 int matrix and up) always come from the heap
+constexpr std::size_t MATRIX_POOL_MAX_BLOCK = std::size_t(4) << 20;
+
+
+// Size-classed free lists of matrix buffers, one set per thread and reused
+// across evals: the temporaries of an evaluation are freed right after their
+// consumer runs, and the next temporary of a similar size takes the same
+// buffer back instead of going through malloc and free.
+//
+// Sizes are rounded up to a class (four per power of two, at most 25% over),
+// so any buffer of a class can serve any request of that class. A buffer
+// freed on another thread than the one that allocated it joins the free
+// lists of that thread. Buffers beyond MATRIX_POOL_MAX_BYTES go back to the
+// heap.
+class MatrixPool
+{
+public:
+    static void* allocate(std::size_t bytes);
+    static void deallocate(void* p, std::size_t bytes) noexcept;
+
+    // Reuse can be turned off (e.g. to compare in a benchmark); buffers are
+    // then freed at once, but still rounded to their class
+    static void setEnabled(bool enabled);
+    static bool enabled();
+    // bytes kept in the free lists of the calling thread
+    static std::size_t retainedBytes();
+};
+
+
+// std::allocator through the MatrixPool
+template <typename T>
+struct PoolAllocator
+{
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "the pool returns operator new alignment");
+        return static_cast<T*>(MatrixPool::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept { MatrixPool::deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+};
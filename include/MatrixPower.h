@@ -0,0 +1,73 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <bit>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+
+// The matrix power base^k (k >= 1) by square-and-multiply: the squares
+// base^(2^j) are multiplied into the result from the lowest bit of k, so it
+// takes powerProducts(k) products instead of k - 1.
+//
+// An integral power is range checked at every product, as a chain of Mul
+// would be: the window keeps every intermediate value exact in the element
+// type. A floating point power is checked only once, on the result - its
+// intermediate values cannot overflow the type (e.g. the powers of a Markov
+// matrix, whose values stay in [0, 1], for k in the thousands).
+
+// floor(log2 k) squares and popcount(k) - 1 other products
+inline int powerProducts(int k)
+{
+    const auto bits = static_cast<unsigned>(k);
+    return static_cast<int>(std::bit_width(bits)) + std::popcount(bits) - 2;
+}
+
+// lhs * rhs inside a power: without the range check for floating point
+template <typename E>
+SquareMatrix<E> powerProduct(const SquareMatrix<E>& lhs, const SquareMatrix<E>& rhs)
+{
+    if constexpr (std::is_floating_point_v<E>)
+    {
+        auto result = SquareMatrix<E>(lhs.size(), E());
+        kernels::gemmFloat(lhs.size(), lhs.data(), rhs.data(), result.data());
+        return result;
+    }
+    else
+        return lhs * rhs;
+}
+
+// square(previous, j) returns base^(2^j) as a shared_ptr, given previous ==
+// base^(2^(j - 1)); Program::run looks the squares up in its EvalCache
+template <typename E, typename Square>
+SquareMatrix<E> power(const SquareMatrix<E>& base, int k, Square&& square)
+{
+    auto result = std::optional<SquareMatrix<E>>();
+    const SquareMatrix<E>* factor = &base;
+    auto held = std::shared_ptr<const SquareMatrix<E>>();
+    for (int j = 1; ; ++j)
+    {
+        if (k & 1)
+            result = result ? powerProduct(*result, *factor) : *factor;
+        k >>= 1;
+        if (k == 0)
+            break;
+        held = square(*factor, j);
+        factor = held.get();
+    }
+
+    if constexpr (std::is_floating_point_v<E>)
+        result->checkValues();
+    return std::move(*result);
+}
+
+// power() with every square computed
+template <typename E>
+SquareMatrix<E> power(const SquareMatrix<E>& base, int k)
+{
+    return power(base, k, [](const SquareMatrix<E>& previous, int) {
+        return std::make_shared<const SquareMatrix<E>>(powerProduct(previous, previous));
+    });
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+
+// A read-only size x size matrix that lives in memory owned by someone else
+// (e.g. a mapped MatrixFile), with the row-major layout of SquareMatrix.
+// Nothing is copied until a SquareMatrix is made of it.
+template <typename T>
+class MatrixView
+{
+public:
+    using value_type = T;
+
+    MatrixView(const T* data, int size) : m_data(data), m_size(size) {}
+
+    int size() const { return m_size; }
+    std::size_t count() const { return static_cast<std::size_t>(m_size) * static_cast<std::size_t>(m_size); }
+    const T* data() const { return m_data; }
+    const T* row(int i) const { return m_data + static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size); }
+    const T& operator()(int i, int j) const { return row(i)[j]; }
+
+private:
+    const T* m_data;
+    int m_size;
+};
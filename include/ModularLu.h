@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+// The exact factorization of an integral matrix, for LuFactorization<E> of
+// the integral element types.
+//
+// The values of det(A) and of A^-1 B are fractions whose parts grow with the
+// size (about n * log2(n * max |a|) bits), so they are not computed in a
+// fixed width type. The matrix is factored modulo primes below 2^29 instead
+// (fraction-free, every value is a residue): det(A) modulo each prime comes
+// from its diagonal, and the exact det is put together from the residues by
+// the Chinese remainder theorem, with enough primes for the Hadamard bound
+// of |det(A)|.
+//
+// A^-1 B is exact if it is an integer matrix in the window: the solution
+// modulo one prime is then that matrix, which A X == B confirms. Otherwise
+// the values N / det(A) of the solution (N = det(A) x, an integer) are
+// reconstructed from enough primes to find the first one that is not an
+// integer in the window, and it is reported in lowest terms, as "1/3".
+//
+// Every prime is factored by blocks as the floating point form is (see
+// LuFactorization.h): the sums of the products of a block are kept in 64
+// bits and reduced once per LU_BLOCK products.
+class ModularLu
+{
+public:
+    // values: the size x size matrix, row-major; block: columns per block
+    ModularLu(std::vector<std::int64_t> values, int size, int block);
+
+    int size() const { return m_size; }
+    bool singular() const { return !m_factors; }
+
+    // det(A); a FileException if it is not in the window
+    std::int64_t determinant() const;
+    // A^-1 rhs (size x size, row-major); a FileException if A is singular or
+    // a value is not an integer in the window
+    std::vector<std::int64_t> solve(const std::vector<std::int64_t>& rhs) const;
+
+private:
+    // P A = L U modulo a prime
+    struct Factors
+    {
+        std::uint32_t prime = 0;
+        std::vector<std::uint32_t> lu;
+        std::vector<int> pivots;
+        std::uint32_t det = 0; // zero: the matrix is singular modulo prime, lu is not complete
+    };
+
+    Factors factor(std::uint32_t prime) const;
+    // (A^-1 rhs) modulo the prime of factors, for rhs of columns columns
+    std::vector<std::uint32_t> solve(const Factors& factors, const std::vector<std::int64_t>& rhs, int columns) const;
+
+    int m_size;
+    int m_block;
+    std::vector<std::int64_t> m_values;
+    // log2 of the Hadamard bounds of |det(A)| by rows and columns
+    double m_rowBits = 0;
+    double m_columnBits = 0;
+    // the first primes factored, up to the first at which A is not singular
+    std::size_t m_primes = 0;
+    std::optional<Factors> m_factors;
+};
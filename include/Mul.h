@@ -0,0 +1,15 @@
+#pragma once
+
+#include "BinaryOperation.h"
+
+#include <memory>
+
+
+class Mul : public BinaryOperation
+{
+public:
+    using BinaryOperation::BinaryOperation;
+    T compute(Input input) const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
+    void printSymbol(std::ostream& ostr) const override;
+};
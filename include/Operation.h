@@ -1,26 +1,90 @@
 #pragma once
 
 #include "SquareMatrix.h"
+#include "Program.h"
+#include "InputView.h"
 
 #include <vector>
 #include <iosfwd>
+#include <optional>
+#include <memory>
+#include <span>
+#include <cstdint>
+#include <typeindex>
+#include <typeinfo>
 
 
-// Represents an operation on sets
+// Represents an operation on sets.
+//
+// compute() is the direct, recursive evaluation on int matrices. An eval
+// runs the compiled program() instead, which does not depend on the element
+// type: Program::run evaluates it on int, std::int64_t, float or double.
 class Operation
 {
 public:
     using T = SquareMatrix<int>;
+    using Term = MatrixTerm<T::value_type>;
+    // the input matrices, passed without copying (see InputView)
+    using Input = InputView<T>;
     virtual ~Operation() = default;
 
     // Return the number of inputs (the range size) expected by compute()
     virtual int inputCount() const = 0;
 
     // Computes the resulted set
-    virtual T compute(const std::vector<T>& input) const =0;
+    virtual T compute(Input input) const =0;
+
+    // compute() of a single input (inputCount() == 1) that the caller gives
+    // away, so that the operation may reuse its storage
+    virtual T consume(T input) const;
+
+    // The result as a lazy view of the input (see MatrixTerm), for operations
+    // that are only a transposed / scaled read of it. A parent can then fuse
+    // it into its own pass instead of materializing it. Empty by default.
+    virtual std::optional<Term> term(Input input) const;
+
+    // Emits the instructions computing this operation from the given input
+    // registers and returns the register (or view) holding the result
+    virtual Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const = 0;
+
+    // The compiled form of this operation, built on first use and then kept
+    const Program& program() const;
+
+    // A number identifying this operation, unique for the whole run (unlike
+    // its address, which a new operation may reuse after a delete)
+    std::uint64_t id() const { return m_id; }
+
+    // What makes two operations the same, for hash-consing (OperationTable):
+    // the kind, the parameter and the children, compared by identity
+    struct Structure
+    {
+        std::type_index kind;
+        std::optional<int> parameter;
+        std::vector<std::uint64_t> children; // their id()
+
+        bool operator==(const Structure&) const = default;
+    };
+
+    // A leaf without parameters by default
+    virtual Structure structure() const;
 
     // Prints the operation with generic name for the sets or with the actual input arguments
     virtual void print(std::ostream& ostr, bool first_print = false) const = 0;
 
-    virtual void print(std::ostream& ostr, const std::vector<T>& input) const;
+    // The same with the input matrices of an eval, of any element type
+    template <typename E>
+    void print(std::ostream& ostr, std::span<const SquareMatrix<E>> input) const
+    {
+        print(ostr);
+        for (std::size_t i = 0; i < static_cast<std::size_t>(inputCount()); ++i)
+        {
+            ostr << "(\n" << input[i] << ")";
+        }
+    }
+
+private:
+    static std::uint64_t nextId();
+
+    const std::uint64_t m_id = nextId();
+    mutable std::shared_ptr<const Program> m_program;
 };
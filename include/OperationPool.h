@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Operation.h"
+#include "OperationTable.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Levels an operation tree may have: compile(), compute() and print() recurse
+// once per level, so a deeper tree could overflow the stack
+constexpr std::uint32_t OPERATION_MAX_DEPTH = 1024;
+
+
+// A node of an OperationPool: the index of its slot and the generation of
+// the slot when the node was created, so that a handle of a deleted node is
+// recognized even after its slot was reused
+struct OperationHandle
+{
+    std::uint32_t index = 0;
+    std::uint32_t generation = 0;
+
+    bool operator==(const OperationHandle&) const = default;
+};
+
+
+// Owns the nodes of operation trees, in one array of slots. A node refers
+// to its children by slot index (a BinaryOperation only points at them),
+// and the pool counts the references to every node: one per parent and one
+// per handle given out. When the count of a node drops to zero, the node
+// and then the children only it kept alive are freed, without recursion,
+// and their slots are reused in O(1).
+//
+// With interning, creating an operation equal to a live node (see
+// OperationTable) returns that node instead, with one more reference.
+// A node deeper than OPERATION_MAX_DEPTH is an InputException.
+class OperationPool
+{
+public:
+    explicit OperationPool(bool intern = true);
+    OperationPool(const OperationPool&) = delete;
+    OperationPool& operator=(const OperationPool&) = delete;
+
+    // A new leaf operation (Identity, Transpose, Scalar), with a reference for the caller
+    template <typename Op, typename... Args>
+    OperationHandle emplace(Args&&... args)
+    {
+        return insert(std::make_unique<Op>(std::forward<Args>(args)...), {});
+    }
+
+    // A new binary operation of two live nodes, with a reference for the caller
+    template <typename Op>
+    OperationHandle combine(OperationHandle first, OperationHandle second)
+    {
+        return insert(std::make_unique<Op>((*this)[first], (*this)[second]), { first, second });
+    }
+
+    // A new operation of one live node and its own arguments (Pow), with a reference for the caller
+    template <typename Op, typename... Args>
+    OperationHandle apply(OperationHandle child, Args&&... args)
+    {
+        return insert(std::make_unique<Op>((*this)[child], std::forward<Args>(args)...), { child });
+    }
+
+    // The operation of a live node; an InputException for a deleted one
+    const Operation& operator[](OperationHandle handle) const;
+    bool contains(OperationHandle handle) const;
+
+    void retain(OperationHandle handle);
+    void release(OperationHandle handle);
+
+    // number of live nodes
+    std::size_t size() const { return m_size; }
+    std::size_t references(OperationHandle handle) const;
+
+private:
+    static constexpr std::uint32_t NoSlot = ~std::uint32_t(0);
+
+    struct Slot
+    {
+        std::unique_ptr<Operation> operation;
+        std::uint32_t generation = 0;
+        std::uint32_t references = 0;
+        std::uint32_t depth = 0;
+        std::uint32_t children[2] = { NoSlot, NoSlot };
+        std::uint32_t nextFree = NoSlot;
+    };
+
+    OperationHandle insert(std::unique_ptr<Operation> operation, std::initializer_list<OperationHandle> children);
+    // the slot of a live node; throws for a deleted one
+    std::uint32_t slotOf(OperationHandle handle) const;
+
+    std::vector<Slot> m_slots;
+    std::uint32_t m_free = NoSlot; // the first free slot; the others follow through nextFree
+    std::size_t m_size = 0;
+    bool m_intern;
+    OperationTable m_table;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Operation.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+
+// Hash-consing of operations, for the OperationPool: it maps the structure
+// of every interned node (Operation::Structure) to its slot, so identical
+// trees built by different commands share their nodes - and with them the
+// compiled program and the EvalCache entries of the node. Since the
+// children of an interned node are interned too, two interned operations
+// are structurally equal exactly when they are the same node (equal()).
+//
+// The pool erases the entry of a node when it frees it.
+class OperationTable
+{
+public:
+    // The slot of the node with this structure, if there is one
+    std::optional<std::uint32_t> find(const Operation::Structure& structure) const;
+    void insert(Operation::Structure structure, std::uint32_t slot);
+    void erase(const Operation::Structure& structure);
+
+    // Structural equality of interned operations, in O(1)
+    static bool equal(const Operation& a, const Operation& b) { return a.id() == b.id(); }
+
+    std::size_t size() const { return m_entries.size(); }
+
+private:
+    struct StructureHash
+    {
+        std::size_t operator()(const Operation::Structure& structure) const;
+    };
+
+    std::unordered_map<Operation::Structure, std::uint32_t, StructureHash> m_entries;
+};
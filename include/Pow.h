@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Operation.h"
+
+
+// The result of an operation raised to a power k >= 1, by square-and-multiply
+// (see MatrixPower.h). Like the children of a BinaryOperation, the base is
+// not owned: it lives in the OperationPool that holds this operation.
+class Pow : public Operation
+{
+public:
+    Pow(const Operation& base, int exponent);
+    int inputCount() const override { return m_baseCount; }
+    T compute(Input input) const override;
+    Structure structure() const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
+    void print(std::ostream& ostr, bool first_print = false) const override;
+
+private:
+    const Operation* const m_base;
+    const int m_baseCount;
+    const int m_exponent;
+};
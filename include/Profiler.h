@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Build with -DOOP2_PROFILE=1 (the CMake option OOP2_PROFILE) to record the
+// cost of every operation Program::run evaluates; without it there is no
+// timing code in run() at all
+#if !defined(OOP2_PROFILE)
+#define OOP2_PROFILE 0
+#endif
+
+
+// What the Profiler recorded for one operation since the last reset
+struct OperationStats
+{
+    std::uint64_t operation = 0; // Operation::id()
+    std::string name;
+    std::uint64_t calls = 0;
+    std::uint64_t totalNs = 0;
+    std::uint64_t maxNs = 0;
+    std::uint64_t bytes = 0;    // of the matrices its instructions allocated
+    std::uint64_t elements = 0; // element operations: n * n per element-wise instruction, n * n * n per product
+};
+
+
+// Per-operation counters for the stats command, keyed by Operation::id().
+//
+// A call is one Program::run that executed instructions of the operation;
+// its time, bytes and elements include those of its children (an operation
+// is in the owner list of every instruction emitted while it compiled).
+// Views (Identity, Transpose, Scalar) are fused into their consumer and only
+// show up when they are materialized. Safe to record from several threads.
+class Profiler
+{
+public:
+    static constexpr bool Enabled = OOP2_PROFILE != 0;
+
+    // the name printed for operation, set when it is compiled
+    static void describe(std::uint64_t operation, std::string name);
+    static void record(std::uint64_t operation, std::uint64_t ns, std::uint64_t bytes, std::uint64_t elements);
+
+    // every operation recorded since the last reset, the most total time first
+    static std::vector<OperationStats> snapshot();
+    static void reset();
+
+    static void writeTable(std::ostream& ostr, const std::vector<OperationStats>& stats);
+    // [{"operation", "name", "calls", "total_ns", "max_ns", "bytes", "elements"}]
+    static void writeJson(std::ostream& ostr, const std::vector<OperationStats>& stats);
+};
+
+
+// Adds the nanoseconds from its construction to its destruction to ns
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(std::int64_t& ns) : m_ns(ns), m_start(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer()
+    {
+        m_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    std::int64_t& m_ns;
+    std::chrono::steady_clock::time_point m_start;
+};
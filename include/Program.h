@@ -0,0 +1,276 @@
+#pragma once
+
+#include "SquareMatrix.h"
+#include "MatrixView.h"
+#include "Profiler.h"
+
+#include <vector>
+#include <span>
+#include <optional>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+class Operation;
+class EvalCache;
+class ThreadPool;
+
+// Estimated element operations (n * n per element-wise instruction, n * n * n
+// per product) below which a Fork runs its branches one after the other
+constexpr std::size_t PROGRAM_FORK_MIN_COST = std::size_t(1) << 15;
+
+
+// An operation tree compiled into a flat list of register instructions.
+//
+// Registers 0 .. inputCount-1 hold the input matrices; every instruction
+// writes a new register (each register is written once), so the offsets of
+// the inputs consumed by every node are resolved at compile time and eval is
+// a single loop over the instructions, without virtual calls or recursion.
+//
+// Identity, Transpose and Scalar emit no instruction: they produce a view of
+// a register (transposed and/or scaled) that the consuming Add / Sub reads
+// in its fused pass (see MatrixExpression.h). A view is materialized only
+// where a real matrix is needed (Mul operands, the input of another unary
+// operation, the result).
+//
+// Temporaries are released after their last use.
+//
+// An operation that occurs more than once in the tree (the same shared_ptr
+// referenced by several parents) is compiled into a memo block: MemoLookup
+// looks its inputs up in the EvalCache and, on a hit, jumps past the block;
+// MemoStore puts the block's result in the cache. The root is memoized too,
+// but only consulted when the cache keeps entries between evals.
+//
+// The children of Add, Sub and Mul consume disjoint inputs, so their
+// instructions are independent: they are bracketed by Fork / Split / Join
+// and run() executes the two branches in parallel on a ThreadPool when both
+// are expensive enough (see PROGRAM_FORK_MIN_COST).
+//
+// Matrices of FIXED_MATRIX_MIN_SIZE .. FIXED_MATRIX_MAX_SIZE are run on
+// FixedSquareMatrix registers instead (see runFixed()).
+//
+// Larger inputs that are mostly zeros (density at most SPARSE_MAX_DENSITY,
+// counted when run() starts) are kept in CSR form if the program has a
+// product, and the instructions that read sparse registers run on
+// SparseMatrix (see runSparse()). Without a product the conversion costs
+// more than the fused dense passes.
+//
+// The instructions do not depend on the element type: run() is a template,
+// instantiated in Program.cpp for the types of ElementType.
+//
+// Pow computes the squares of its base once per base matrix: they are kept
+// in the EvalCache of the run, so an eval that raises the same matrix to
+// another power (or again, when the cache keeps entries between evals)
+// starts from them.
+//
+// Det, Inverse and Solve share the LuFactorization of their matrix the same
+// way, so the factorization of a matrix is computed once per eval however
+// many of them read it.
+//
+// With OOP2_PROFILE every instruction is timed and charged to the operations
+// that emitted it (see Profiler).
+class Program
+{
+public:
+    // the matrices of an eval of element type E
+    template <typename E>
+    using Matrix = SquareMatrix<E>;
+    using T = Matrix<int>;
+
+    enum class OpCode
+    {
+        Add,
+        Sub,
+        Mul,
+        Materialize, // dst = a (copy of a view)
+        MemoLookup,  // dst = cached result of the block, or run the block
+        MemoStore,   // dst = a, which is added to the cache
+        Fork,        // the next instructions up to Split and from Split to Join are independent
+        Split,
+        Join,
+        Pow,         // dst = a ^ exponent (see MatrixPower.h)
+        Det,         // dst = det(a) * I (see LuFactorization.h)
+        Inverse,     // dst = a^-1
+        Solve,       // dst = a^-1 b
+    };
+
+    // A register, possibly read through a transpose and / or a scalar
+    struct Value
+    {
+        int reg = 0;
+        bool transposed = false;
+        std::optional<int> scale = std::nullopt;
+
+        bool isView() const { return transposed || scale.has_value(); }
+        // only a scaled read can produce values out of range
+        bool checked() const { return scale.has_value(); }
+    };
+
+    struct Operand
+    {
+        Value value;
+        bool lastUse = false; // release the register after this instruction
+    };
+
+    struct Instruction
+    {
+        OpCode code;
+        int dst;
+        Operand a;
+        Operand b;
+
+        // MemoLookup only
+        std::uint64_t operation = 0;  // Operation::id() of the memoized operation
+        std::size_t inputsBegin = 0;  // its inputs: memoInputs()[inputsBegin, inputsEnd)
+        std::size_t inputsEnd = 0;
+        std::size_t skip = 0;         // the instruction after the matching MemoStore
+        bool crossEvalOnly = false;   // look up only if the cache keeps entries between evals
+
+        // Pow only
+        int exponent = 0;
+
+        // Fork only (dst is the id of the Fork, Split and Join)
+        std::size_t split = 0;        // index of the matching Split and Join
+        std::size_t join = 0;
+        std::size_t elementwise[2] = {}; // element-wise instructions and products of each branch
+        std::size_t products[2] = {};
+#if OOP2_PROFILE
+        std::size_t owners = 0; // index into Program::m_owners
+#endif
+    };
+
+    // Emits instructions while an operation tree compiles itself (Operation::compile)
+    class Builder
+    {
+    public:
+        explicit Builder(int inputCount);
+
+        // Compiles a child operation; use it instead of calling operation.compile()
+        // directly, so that shared operations can be memoized
+        Value compile(const Operation& operation, std::span<const Value> input);
+
+        // index of the next instruction
+        std::size_t position() const { return m_code.size(); }
+
+        // dst = a (op) b, or dst = (op) a
+        Value emit(OpCode code, const Value& a, const Value& b);
+        Value emit(OpCode code, const Value& a);
+        // dst = a ^ exponent, for a plain register a
+        Value power(const Value& a, int exponent);
+        // a as a plain register, materializing it if it is a view
+        Value plain(const Value& a);
+        // like plain(), but the copy is inserted before instruction #position
+        Value plainAt(std::size_t position, const Value& a);
+
+        // Brackets the instructions of two independent children: fork() before
+        // the first one, split() between them (returns the position of the
+        // Split) and join() after the second one
+        int fork();
+        std::size_t split(int fork);
+        void join(int fork);
+
+        Program finish(const Value& result);
+
+    private:
+        friend class Program;
+
+        // an instruction of the operations being compiled
+        Instruction make(OpCode code, int dst, const Value& a, const Value& b) const;
+
+        int m_inputCount;
+        int m_registerCount;
+        std::vector<Instruction> m_code;
+        std::vector<Operand> m_memoInputs;
+        int m_forkCount = 0;
+
+        // the first compile pass only counts, the second one memoizes
+        bool m_counting = true;
+        int m_depth = 0;
+        std::unordered_map<const Operation*, int> m_visits;
+        std::unordered_set<const Operation*> m_emits;
+
+#if OOP2_PROFILE
+        // the ids of the operations being compiled, outermost first, for
+        // every nesting seen so far; m_owner is the current one
+        std::vector<std::vector<std::uint64_t>> m_owners{ {} };
+        std::size_t m_owner = 0;
+#endif
+    };
+
+    // Compiles operation and all its children
+    static Program compile(const Operation& operation);
+
+    // Runs the program on operation.inputCount() input matrices, reusing
+    // the results of memoized operations from cache and running independent
+    // branches on pool (if given)
+    template <typename E>
+    Matrix<E> run(std::span<const Matrix<E>> input, EvalCache* cache = nullptr, ThreadPool* pool = nullptr) const;
+    template <typename E>
+    Matrix<E> run(const std::vector<Matrix<E>>& input, EvalCache* cache = nullptr, ThreadPool* pool = nullptr) const
+    {
+        return run(std::span<const Matrix<E>>(input), cache, pool);
+    }
+    // run() on matrices that are not in a SquareMatrix (e.g. in a mapped
+    // MatrixFile); at the fixed sizes they are read where they are
+    template <typename E>
+    Matrix<E> run(std::span<const MatrixView<E>> input, EvalCache* cache = nullptr, ThreadPool* pool = nullptr) const;
+
+    // The sparse representation can be turned off (e.g. to compare in a benchmark)
+    static void setSparseEnabled(bool enabled);
+    static bool sparseEnabled();
+
+    int inputCount() const { return m_inputCount; }
+    int registerCount() const { return m_registerCount; }
+    const std::vector<Instruction>& code() const { return m_code; }
+    const std::vector<Operand>& memoInputs() const { return m_memoInputs; }
+
+private:
+    template <typename E>
+    struct State;
+
+    // runs instructions [begin, end)
+    template <typename E>
+    void execute(State<E>& state, std::size_t begin, std::size_t end) const;
+
+    // run() for N x N inputs, on FixedSquareMatrix<E, N> registers. No
+    // Fork is worth a thread at these sizes, and a memoized block is cheaper
+    // to recompute than to look up, so the markers are skipped; used only
+    // when the cache does not keep entries between evals.
+    template <int N, typename M>
+    Matrix<typename M::value_type> runFixed(std::span<const M> input) const;
+    // runFixed() for the size of input, if it is one of the fixed sizes
+    template <typename M>
+    std::optional<Matrix<typename M::value_type>> runFixedSize(std::span<const M> input, const EvalCache* cache) const;
+
+    // run() with the inputs that are sparse enough in CSR form. A result
+    // that is sparse too stays in CSR form, the others are dense; add and
+    // sub of a sparse and a dense register are dense, a product with a
+    // sparse operand skips its zeros. Used only when no memo block is looked
+    // up (a block is recomputed, as without a cache) and no factorization is
+    // shared, and the Forks run inline; nullopt if no input is sparse.
+    template <typename E>
+    std::optional<Matrix<E>> runSparse(std::span<const Matrix<E>> input, const EvalCache* cache) const;
+
+#if OOP2_PROFILE
+    // Records one call of every operation that owns an instruction that ran:
+    // times[pc] is the time of instruction pc, -1 if it did not run
+    void profile(const std::vector<std::int64_t>& times, int size, std::size_t elementSize, bool fixed) const;
+#endif
+
+    Program(int inputCount, int registerCount, int result, std::vector<Instruction> code, std::vector<Operand> memoInputs);
+
+    int m_inputCount;
+    int m_registerCount;
+    int m_result;
+    std::vector<Instruction> m_code;
+    std::vector<Operand> m_memoInputs;
+    // some memo block is looked up within an eval (an operation that occurs more than once)
+    bool m_sharedBlocks = false;
+    // the program has a product (see runSparse())
+    bool m_products = false;
+    // the program factors a matrix (Det, Inverse, Solve)
+    bool m_factors = false;
+#if OOP2_PROFILE
+    std::vector<std::vector<std::uint64_t>> m_owners;
+#endif
+};
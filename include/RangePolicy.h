@@ -0,0 +1,142 @@
+#pragma once
+
+#include "FileException.h"
+
+#include <charconv>
+#include <optional>
+#include <string>
+#include <type_traits>
+
+
+// Range policies of SquareMatrix: what a matrix does with a value outside
+// the open window (MIN_ALLOWED_VALU, MAX_ALLOWED_VALUE).
+//
+// The kernels test the range without branches (SimdKernels.h) and call the
+// policy only on the slow path, when some value is outside: fix() gets the
+// exact (widened) value and returns the one to store, or throws. A policy
+// with checks == false makes the operations use the plain kernels, without
+// any range test. Report is the state a matrix keeps for the policy (empty
+// except for DeferredRange).
+
+// Window of valid values, as the exact type of a widened value (false for NaN)
+template <typename W>
+bool isInRange(const W& val)
+{
+	return val > W(MIN_ALLOWED_VALU) && val < W(MAX_ALLOWED_VALUE);
+}
+
+// val as an error message shows it; a floating point value in its shortest
+// form (1100.5, not 1100.500000)
+template <typename W>
+std::string valueText(const W& val)
+{
+	if constexpr (std::is_integral_v<W>)
+		return std::to_string(val);
+	else
+	{
+		char buffer[64];
+		const auto result = std::to_chars(buffer, buffer + sizeof(buffer), val);
+		return std::string(buffer, result.ptr);
+	}
+}
+
+struct NoRangeReport
+{
+	void merge(const NoRangeReport&) {}
+	void validate() const {}
+};
+
+// The strict mode (the default): an invalid value is a FileException
+struct ThrowingRange
+{
+	static constexpr bool checks = true;
+	using Report = NoRangeReport;
+
+	template <typename W>
+	static W fix(const W& val, Report&)
+	{
+		if (!isInRange(val))
+			throw FileException("the value: " + valueText(val) + " ,is invalid value");
+		return val;
+	}
+};
+
+// An invalid value is replaced by the closest valid one
+struct SaturatingRange
+{
+	static constexpr bool checks = true;
+	using Report = NoRangeReport;
+
+	template <typename W>
+	static W fix(const W& val, Report&)
+	{
+		if (val <= W(MIN_ALLOWED_VALU))
+			return W(MIN_ALLOWED_VALU + 1);
+		if (val >= W(MAX_ALLOWED_VALUE))
+			return W(MAX_ALLOWED_VALUE - 1);
+		return val;
+	}
+};
+
+// Modular arithmetic over the valid values: an invalid value wraps around
+// the window (integral types only)
+struct WrappingRange
+{
+	static constexpr bool checks = true;
+	using Report = NoRangeReport;
+
+	template <typename W>
+	static W fix(const W& val, Report&)
+	{
+		const auto lowest = W(MIN_ALLOWED_VALU + 1);
+		const auto width = W(MAX_ALLOWED_VALUE) - lowest;
+		const auto offset = (val - lowest) % width;
+		return lowest + (offset < 0 ? offset + width : offset);
+	}
+};
+
+// No range test at all; integral overflow wraps around the element type
+struct UncheckedRange
+{
+	static constexpr bool checks = false;
+	using Report = NoRangeReport;
+
+	template <typename W>
+	static W fix(const W& val, Report&) { return val; }
+};
+
+// Invalid values are kept (narrowed to the element type) and the first one
+// is remembered; validate() throws for it later. A result inherits the
+// report of its operands, so the first invalid value of a whole chain of
+// operations is reported once, at the end.
+struct DeferredRange
+{
+	static constexpr bool checks = true;
+
+	struct Report
+	{
+		std::optional<long double> firstInvalid;
+
+		void merge(const Report& other)
+		{
+			if (!firstInvalid)
+				firstInvalid = other.firstInvalid;
+		}
+		void validate() const
+		{
+			if (firstInvalid)
+				throw FileException("the value: " + valueText(*firstInvalid) + " ,is invalid value");
+		}
+	};
+
+	template <typename W>
+	static W fix(const W& val, Report& report)
+	{
+		if (!isInRange(val) && !report.firstInvalid)
+			report.firstInvalid = static_cast<long double>(val);
+		return val;
+	}
+};
+
+template <typename T, typename Policy = ThrowingRange>
+class SquareMatrix;
@@ -10,7 +10,10 @@ class Scalar : public UnaryOperation
 {
 public:
     Scalar(int scalar);
-    T compute(const std::vector<T>& input) const override;
+    T compute(Input input) const override;
+    std::optional<Term> term(Input input) const override;
+    Structure structure() const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 private:
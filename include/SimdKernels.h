@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+
+// Element-wise kernels for int matrices with explicit SSE2 / AVX2 code paths,
+// and for float and double matrices with AVX2 code paths. The instruction
+// set is chosen once at run time from what the CPU supports (scalar code on
+// other targets).
+//
+// Each kernel computes the whole buffer and keeps an OR of "out of range"
+// lane masks instead of branching per element. It returns false when any
+// result is outside the open interval (lo, hi) or overflowed int; the
+// caller then finds and reports the offending value on a slow path.
+// Floating point values cannot overflow, so those kernels only test the
+// range, with twice (float) or the same (double) number of lanes as int.
+//
+// std::int64_t has no kernel of its own: AVX2 has no 64-bit multiply, so it
+// uses the generic loops of MatrixKernels.h.
+namespace kernels
+{
+    bool addInRange(const int* a, const int* b, int* out, std::size_t count, int lo, int hi);
+    bool subInRange(const int* a, const int* b, int* out, std::size_t count, int lo, int hi);
+    bool scaleInRange(const int* a, int scalar, int* out, std::size_t count, int lo, int hi);
+
+    // The same kernels without a range (UncheckedRange): the int overloads of
+    // the plain kernels in MatrixKernels.h, so they also use the dispatched
+    // code; the results wrap around on overflow
+    inline void add(const int* a, const int* b, int* out, std::size_t count)
+    {
+        addInRange(a, b, out, count, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+    inline void sub(const int* a, const int* b, int* out, std::size_t count)
+    {
+        subInRange(a, b, out, count, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+    inline void scale(const int* a, int scalar, int* out, std::size_t count)
+    {
+        scaleInRange(a, scalar, out, count, std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+
+    bool addInRange(const float* a, const float* b, float* out, std::size_t count, float lo, float hi);
+    bool subInRange(const float* a, const float* b, float* out, std::size_t count, float lo, float hi);
+    bool scaleInRange(const float* a, float scalar, float* out, std::size_t count, float lo, float hi);
+    bool addInRange(const double* a, const double* b, double* out, std::size_t count, double lo, double hi);
+    bool subInRange(const double* a, const double* b, double* out, std::size_t count, double lo, double hi);
+    bool scaleInRange(const double* a, double scalar, double* out, std::size_t count, double lo, double hi);
+
+    // c = a * b for n x n int matrices, blocked like kernels::gemm with an AVX2 micro kernel when available
+    void gemmInt(int n, const int* a, const int* b, int* c);
+    // The same for float and double. The products are added in the order of
+    // kernels::gemm, without fused multiply-adds, so the results are the
+    // same as the generic loops (and FixedSquareMatrix) to the last bit
+    void gemmFloat(int n, const float* a, const float* b, float* c);
+    void gemmFloat(int n, const double* a, const double* b, double* c);
+
+    // kernels::subtractProductsTile for float and double, with an AVX2 micro
+    // kernel when available: the same results to the last bit
+    void subtractProducts(int n, const float* a, const float* b, float* c, int i0, int i1, int k0, int k1, int j0, int j1);
+    void subtractProducts(int n, const double* a, const double* b, double* c, int i0, int i1, int k0, int k1, int j0, int j1);
+
+    // Name of the instruction set the kernels dispatch to ("avx2", "sse2" or "scalar")
+    const char* simdLevel();
+}
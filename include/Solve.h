@@ -0,0 +1,15 @@
+#pragma once
+
+#include "BinaryOperation.h"
+
+
+// The solution X of first * X = second, i.e. first^-1 second (the
+// backslash of MATLAB), from the LU factorization of first
+class Solve : public BinaryOperation
+{
+public:
+    using BinaryOperation::BinaryOperation;
+    T compute(Input input) const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
+    void printSymbol(std::ostream& ostr) const override;
+};
@@ -0,0 +1,374 @@
+#pragma once
+
+#include "SquareMatrix.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Largest share of non-zero values for which Program::run keeps an input
+// matrix in CSR form (measured when the eval starts). Above it the products
+// with a CSR operand and the merges of filled-in sums cost about as much
+// as the dense operations (bench/SparseBench.cpp)
+constexpr double SPARSE_MAX_DENSITY = 0.03;
+// Smaller matrices are always evaluated dense
+constexpr int SPARSE_MIN_SIZE = 32;
+
+
+// A size x size matrix in compressed sparse row (CSR) form: the non-zero
+// values of row i are values()[rowStart()[i] .. rowStart()[i + 1]), in
+// column order, and columns() holds their columns. Zeros are not stored, so
+// the operations cost the number of non-zero values instead of size * size:
+// add and sub merge the rows, scale and Transpose (CSR to CSC, which is the
+// CSR of the transpose) are one pass over the values, and the products
+// skip every zero term.
+//
+// The range is checked as SquareMatrix<T> does: a result outside
+// (MIN_ALLOWED_VALU, MAX_ALLOWED_VALUE) is a FileException for the first
+// invalid value in row-major order, the one the dense operation reports.
+// The results are exact in the same way: integral values are computed in
+// long long (the products with a dense matrix in T, when no sum can
+// overflow it), and floating point products are added in the order of
+// kernels::gemm (a skipped zero term cannot change a sum).
+template <typename T>
+class SparseMatrix
+{
+public:
+    using value_type = T;
+    template <typename V>
+    using Array = std::vector<V, DefaultInitAllocator<V>>;
+
+    // the non-zero values of dense
+    explicit SparseMatrix(const MatrixView<T>& dense);
+    explicit SparseMatrix(const SquareMatrix<T>& dense) : SparseMatrix(MatrixView<T>(dense.data(), dense.size())) {}
+
+    // The non-zero values of dense, but no more than limit + 1: enough to
+    // tell whether there are more than limit without reading the whole matrix
+    static std::size_t countNonZeros(const MatrixView<T>& dense, std::size_t limit);
+
+    int size() const { return m_size; }
+    std::size_t nonZeros() const { return m_values.size(); }
+    const std::size_t* rowStart() const { return m_rowStart.data(); }
+    const int* columns() const { return m_columns.data(); }
+    const T* values() const { return m_values.data(); }
+    // bytes of the three arrays
+    std::size_t bytes() const;
+
+    SquareMatrix<T> toDense() const;
+
+    static SparseMatrix add(const SparseMatrix& lhs, const SparseMatrix& rhs) { return merge<false>(lhs, rhs); }
+    static SparseMatrix sub(const SparseMatrix& lhs, const SparseMatrix& rhs) { return merge<true>(lhs, rhs); }
+    static SparseMatrix scale(const SparseMatrix& matrix, const T& scalar);
+    SparseMatrix Transpose() const;
+
+    // The products: sparse x dense and dense x sparse are dense, sparse x
+    // sparse is sparse (row by row, Gustavson's algorithm)
+    static SquareMatrix<T> multiply(const SparseMatrix& lhs, const SquareMatrix<T>& rhs);
+    static SquareMatrix<T> multiply(const SquareMatrix<T>& lhs, const SparseMatrix& rhs);
+    static SparseMatrix multiply(const SparseMatrix& lhs, const SparseMatrix& rhs);
+
+private:
+    explicit SparseMatrix(int size);
+
+    // exact type of a result before the range check (as in SquareMatrix)
+    using Wide = std::conditional_t<std::is_integral_v<T>, long long, T>;
+
+    // val after the range check
+    static T checked(Wide val);
+    template <bool Subtract>
+    static SparseMatrix merge(const SparseMatrix& lhs, const SparseMatrix& rhs);
+    // appends the value of column j to the row being built, unless it is zero
+    void push(int j, T val);
+
+    // The products with a dense matrix are accumulated in T, as the dense
+    // one is; fitsProduct() is false when that could overflow
+    static bool fitsProduct(const SparseMatrix& sparse, const T* dense, std::size_t count);
+    // the range check of a complete product
+    static void checkProduct(const SquareMatrix<T>& result);
+
+    int m_size;
+    Array<std::size_t> m_rowStart; // size + 1 offsets into m_columns and m_values
+    Array<int> m_columns;
+    Array<T> m_values;
+};
+
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(int size)
+    : m_size(size), m_rowStart(static_cast<std::size_t>(size) + 1, 0)
+{
+}
+
+template <typename T>
+SparseMatrix<T>::SparseMatrix(const MatrixView<T>& dense)
+    : SparseMatrix(dense.size())
+{
+    const auto n = static_cast<std::size_t>(m_size);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const T* row = dense.row(static_cast<int>(i));
+        for (std::size_t j = 0; j < n; ++j)
+        {
+            if (row[j] != T())
+                push(static_cast<int>(j), row[j]);
+        }
+        m_rowStart[i + 1] = m_values.size();
+    }
+}
+
+template <typename T>
+std::size_t SparseMatrix<T>::countNonZeros(const MatrixView<T>& dense, std::size_t limit)
+{
+    // branch free blocks, with the limit tested once a block
+    constexpr std::size_t BLOCK = 1024;
+    const T* data = dense.data();
+    const auto total = dense.count();
+    auto count = std::size_t(0);
+    for (std::size_t begin = 0; begin < total && count <= limit; begin += BLOCK)
+    {
+        const auto end = std::min(total, begin + BLOCK);
+        for (auto i = begin; i < end; ++i)
+            count += data[i] != T() ? 1 : 0;
+    }
+    return std::min(count, limit + 1);
+}
+
+template <typename T>
+std::size_t SparseMatrix<T>::bytes() const
+{
+    return m_rowStart.size() * sizeof(std::size_t) + m_columns.size() * sizeof(int) + m_values.size() * sizeof(T);
+}
+
+template <typename T>
+SquareMatrix<T> SparseMatrix<T>::toDense() const
+{
+    auto result = SquareMatrix<T>(m_size, T());
+    for (int i = 0; i < m_size; ++i)
+    {
+        T* row = result.row(i);
+        const auto i0 = static_cast<std::size_t>(i);
+        for (auto k = m_rowStart[i0]; k < m_rowStart[i0 + 1]; ++k)
+            row[m_columns[k]] = m_values[k];
+    }
+    return result;
+}
+
+template <typename T>
+T SparseMatrix<T>::checked(Wide val)
+{
+    if (!isInRange(val))
+        throw FileException("the value: " + valueText(val) + " ,is invalid value");
+    return static_cast<T>(val);
+}
+
+template <typename T>
+void SparseMatrix<T>::push(int j, T val)
+{
+    if (val == T())
+        return;
+    m_columns.push_back(j);
+    m_values.push_back(val);
+}
+
+template <typename T>
+template <bool Subtract>
+SparseMatrix<T> SparseMatrix<T>::merge(const SparseMatrix& lhs, const SparseMatrix& rhs)
+{
+    auto result = SparseMatrix(lhs.m_size);
+    result.m_columns.reserve(lhs.nonZeros() + rhs.nonZeros());
+    result.m_values.reserve(lhs.nonZeros() + rhs.nonZeros());
+    for (std::size_t i = 0; i < static_cast<std::size_t>(lhs.m_size); ++i)
+    {
+        // both rows are in column order: walk them together
+        auto a = lhs.m_rowStart[i];
+        auto b = rhs.m_rowStart[i];
+        const auto aEnd = lhs.m_rowStart[i + 1];
+        const auto bEnd = rhs.m_rowStart[i + 1];
+        while (a < aEnd || b < bEnd)
+        {
+            const auto ja = a < aEnd ? lhs.m_columns[a] : lhs.m_size;
+            const auto jb = b < bEnd ? rhs.m_columns[b] : rhs.m_size;
+            const auto x = ja <= jb ? static_cast<Wide>(lhs.m_values[a]) : Wide();
+            const auto y = jb <= ja ? static_cast<Wide>(rhs.m_values[b]) : Wide();
+            result.push(std::min(ja, jb), checked(Subtract ? x - y : x + y));
+            a += ja <= jb ? 1 : 0;
+            b += jb <= ja ? 1 : 0;
+        }
+        result.m_rowStart[i + 1] = result.m_values.size();
+    }
+    return result;
+}
+
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::scale(const SparseMatrix& matrix, const T& scalar)
+{
+    auto result = SparseMatrix(matrix.m_size);
+    if (scalar == T())
+        return result;
+
+    result.m_columns.reserve(matrix.nonZeros());
+    result.m_values.reserve(matrix.nonZeros());
+    for (std::size_t i = 0; i < static_cast<std::size_t>(matrix.m_size); ++i)
+    {
+        for (auto k = matrix.m_rowStart[i]; k < matrix.m_rowStart[i + 1]; ++k)
+            result.push(matrix.m_columns[k], checked(static_cast<Wide>(matrix.m_values[k]) * static_cast<Wide>(scalar)));
+        result.m_rowStart[i + 1] = result.m_values.size();
+    }
+    return result;
+}
+
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::Transpose() const
+{
+    // count the values of every column, then place the rows in order, so
+    // that every row of the result is in column order too
+    const auto n = static_cast<std::size_t>(m_size);
+    auto result = SparseMatrix(m_size);
+    for (const auto j : m_columns)
+        ++result.m_rowStart[static_cast<std::size_t>(j) + 1];
+    for (std::size_t j = 0; j < n; ++j)
+        result.m_rowStart[j + 1] += result.m_rowStart[j];
+
+    result.m_columns.resize(nonZeros());
+    result.m_values.resize(nonZeros());
+    auto next = Array<std::size_t>(result.m_rowStart.begin(), result.m_rowStart.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        for (auto k = m_rowStart[i]; k < m_rowStart[i + 1]; ++k)
+        {
+            const auto slot = next[static_cast<std::size_t>(m_columns[k])]++;
+            result.m_columns[slot] = static_cast<int>(i);
+            result.m_values[slot] = m_values[k];
+        }
+    }
+    return result;
+}
+
+template <typename T>
+bool SparseMatrix<T>::fitsProduct(const SparseMatrix& sparse, const T* dense, std::size_t count)
+{
+    if constexpr (!std::is_integral_v<T>)
+        return true;
+    else
+    {
+        // as SquareMatrix::operator*: no dot product of n terms can overflow T
+        T lo, hi, denseLo, denseHi;
+        kernels::minMax(sparse.values(), sparse.nonZeros(), lo, hi);
+        kernels::minMax(dense, count, denseLo, denseHi);
+        const auto magnitude = [](T a, T b) { return std::max(std::abs(static_cast<double>(a)), std::abs(static_cast<double>(b))); };
+        return magnitude(lo, hi) * magnitude(denseLo, denseHi) * sparse.m_size <= static_cast<double>(std::numeric_limits<T>::max());
+    }
+}
+
+template <typename T>
+void SparseMatrix<T>::checkProduct(const SquareMatrix<T>& result)
+{
+    T lo, hi;
+    kernels::minMax(result.data(), result.count(), lo, hi);
+    if (lo <= T(MIN_ALLOWED_VALU) || hi >= T(MAX_ALLOWED_VALUE))
+        std::for_each(result.data(), result.data() + result.count(), [](T val) { checked(static_cast<Wide>(val)); });
+}
+
+template <typename T>
+SquareMatrix<T> SparseMatrix<T>::multiply(const SparseMatrix& lhs, const SquareMatrix<T>& rhs)
+{
+    // the values are exact in T unless a product can overflow; then the dense product is
+    if (!fitsProduct(lhs, rhs.data(), rhs.count()))
+        return lhs.toDense() * rhs;
+
+    // row i of the result is the sum of the rows k of rhs scaled by lhs(i, k)
+    const auto n = static_cast<std::size_t>(lhs.m_size);
+    auto result = SquareMatrix<T>(lhs.m_size, T());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        T* out = result.row(static_cast<int>(i));
+        for (auto k = lhs.m_rowStart[i]; k < lhs.m_rowStart[i + 1]; ++k)
+        {
+            const auto x = lhs.m_values[k];
+            const T* source = rhs.row(lhs.m_columns[k]);
+            for (std::size_t j = 0; j < n; ++j)
+                out[j] += x * source[j];
+        }
+    }
+    checkProduct(result);
+    return result;
+}
+
+template <typename T>
+SquareMatrix<T> SparseMatrix<T>::multiply(const SquareMatrix<T>& lhs, const SparseMatrix& rhs)
+{
+    if (!fitsProduct(rhs, lhs.data(), lhs.count()))
+        return lhs * rhs.toDense();
+
+    // lhs(i, k) scales the values of row k of rhs, for k in order
+    const auto n = static_cast<std::size_t>(rhs.m_size);
+    auto result = SquareMatrix<T>(rhs.m_size, T());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const T* source = lhs.row(static_cast<int>(i));
+        T* out = result.row(static_cast<int>(i));
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            const auto x = source[k];
+            for (auto p = rhs.m_rowStart[k]; p < rhs.m_rowStart[k + 1]; ++p)
+                out[rhs.m_columns[p]] += x * rhs.m_values[p];
+        }
+    }
+    checkProduct(result);
+    return result;
+}
+
+template <typename T>
+SparseMatrix<T> SparseMatrix<T>::multiply(const SparseMatrix& lhs, const SparseMatrix& rhs)
+{
+    // every row is accumulated in a dense row, and only the columns it
+    // touched are read back (in order) and cleared
+    const auto n = static_cast<std::size_t>(lhs.m_size);
+    auto result = SparseMatrix(lhs.m_size);
+    auto row = Array<Wide>(n);
+    std::fill(row.begin(), row.end(), Wide());
+    auto touched = Array<char>(n);
+    std::fill(touched.begin(), touched.end(), char(0));
+    auto columns = Array<int>();
+    columns.reserve(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        columns.clear();
+        for (auto k = lhs.m_rowStart[i]; k < lhs.m_rowStart[i + 1]; ++k)
+        {
+            const auto x = static_cast<Wide>(lhs.m_values[k]);
+            const auto r = static_cast<std::size_t>(lhs.m_columns[k]);
+            for (auto p = rhs.m_rowStart[r]; p < rhs.m_rowStart[r + 1]; ++p)
+            {
+                const auto j = static_cast<std::size_t>(rhs.m_columns[p]);
+                if (!touched[j])
+                {
+                    touched[j] = 1;
+                    columns.push_back(static_cast<int>(j));
+                }
+                row[j] += x * static_cast<Wide>(rhs.m_values[p]);
+            }
+        }
+        // a row that filled in is read in order instead of sorting its columns
+        if (columns.size() * 16 > n)
+        {
+            columns.clear();
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                if (touched[j])
+                    columns.push_back(static_cast<int>(j));
+            }
+        }
+        else
+            std::sort(columns.begin(), columns.end());
+        for (const auto j : columns)
+        {
+            const auto at = static_cast<std::size_t>(j);
+            result.push(j, checked(row[at]));
+            row[at] = Wide();
+            touched[at] = 0;
+        }
+        result.m_rowStart[i + 1] = result.m_values.size();
+    }
+    return result;
+}
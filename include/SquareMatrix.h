@@ -2,15 +2,59 @@
 
 #include <vector>
 #include <iostream>
+#include <cstddef>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <memory>
+#include <new>
 #include"FileException.h"
+#include "MatrixKernels.h"
+#include "SimdKernels.h"
 const int MAX_ALLOWED_VALUE = 1024;
 const int MIN_ALLOWED_VALU = -1024;
-const int MAX_MAT_SIZE = 5;
 
+#include "RangePolicy.h"
+#include "MatrixExpression.h"
+#include "MatrixView.h"
+#include "MatrixFormatter.h"
+#include "MatrixPool.h"
+
+// The MatrixPool allocator, except that elements constructed without a value
+// are default-initialized (left uninitialized for int): resize() then only
+// allocates a buffer that is about to be overwritten
 template <typename T>
+struct DefaultInitAllocator : PoolAllocator<T>
+{
+	template <typename U>
+	struct rebind { using other = DefaultInitAllocator<U>; };
+
+	DefaultInitAllocator() = default;
+	template <typename U>
+	DefaultInitAllocator(const DefaultInitAllocator<U>&) noexcept {}
+
+	template <typename U>
+	void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new (static_cast<void*>(p)) U; }
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+};
+
+// The matrix is kept in one row-major contiguous buffer: element (i, j) lives
+// at index i * size + j, so a whole matrix is a single allocation and rows are
+// adjacent in memory.
+//
+// Policy (RangePolicy.h) decides what happens to the values outside the valid
+// window; the default throws a FileException, as the calculator requires.
+
+template <typename T, typename Policy>
 class SquareMatrix
 {
 public:
+	using value_type = T;
+	using policy_type = Policy;
+
 	SquareMatrix(const SquareMatrix&) = default;
 	SquareMatrix(SquareMatrix&&) = default;
 	SquareMatrix& operator=(const SquareMatrix&) = default;
@@ -20,187 +64,364 @@ public:
 	//SquareMatrix(std::vector<std::vector<T>>&& matrix);
 	SquareMatrix(int size, const T& value);
 	SquareMatrix(int size);// i don't know why he did this strange c-tor !!!!!    
+	// a size x size matrix whose elements are left uninitialized, for results
+	// and inputs that are written completely
+	struct NoFill {};
+	SquareMatrix(int size, NoFill);
+	// A copy of the values of view (not checked)
+	explicit SquareMatrix(const MatrixView<T>& view);
+	// Evaluates an expression (a + b, a - b, a * scalar, ...) in one fused pass
+	template <MatrixExpressionType E>
+	SquareMatrix(const E& expr);
+	template <MatrixExpressionType E>
+	SquareMatrix& operator=(const E& expr);
 	int size() const
 	{
 		return m_size;
 	};
+	// number of elements in the buffer (size * size)
+	std::size_t count() const { return m_data.size(); }
+	T* data() { return m_data.data(); }
+	const T* data() const { return m_data.data(); }
+	T* row(int i) { return m_data.data() + index(i, 0); }
+	const T* row(int i) const { return m_data.data() + index(i, 0); }
 	T& operator()(int i, int j);
 	const T& operator()(int i, int j) const;
 	SquareMatrix& operator+=(const SquareMatrix& rhs);
 	SquareMatrix& operator-=(const SquareMatrix& rhs);
-	//SquareMatrix& operator*=(const SquareMatrix& rhs);
+	SquareMatrix& operator*=(const SquareMatrix& rhs);
 	//SquareMatrix& operator*=(const T& scalar);
-	SquareMatrix operator+(const SquareMatrix& rhs) const;
-	SquareMatrix operator-(const SquareMatrix& rhs) const;
-	//SquareMatrix operator*(const SquareMatrix& rhs) const;
-	SquareMatrix operator*(const T& scalar) const;
+	// + - and * scalar are non member templates in MatrixExpression.h
+	SquareMatrix operator*(const SquareMatrix& rhs) const;
 	//bool operator==(const SquareMatrix& rhs) const;
 	//bool operator!=(const SquareMatrix& rhs) const;
+	// blocked copy (see kernels::transpose)
 	SquareMatrix Transpose() const;
+	// the same result, without allocating
+	void transposeInPlace();
 	//void print(std::ostream& ostr) const;
 
-	void checkVal(T) const;
+	// Strict checks, whatever the policy: throw a FileException for an invalid value
+	static void checkVal(T);
 	void checkSize(int) const;
+	// checkVal for every element, but with a branch free scan first: the
+	// per element check runs only when some value is out of range
+	void checkValues() const;
+	// the same for values that are not in a SquareMatrix
+	static void checkValues(const MatrixView<T>& view);
+
+	// val as the policy stores it in this matrix (it may throw or record it)
+	T checked(T val);
+	// What the policy remembers about the invalid values (DeferredRange)
+	const typename Policy::Report& report() const { return m_report; }
+	// Throws for the first invalid value a DeferredRange matrix recorded
+	void validate() const { m_report.validate(); }
+
+	// The eager element-wise operations: one full pass each, applying the
+	// policy to the invalid values. The expressions fall back to them to
+	// report errors exactly as an eager evaluation would.
+	static SquareMatrix add(const SquareMatrix& lhs, const SquareMatrix& rhs);
+	static SquareMatrix sub(const SquareMatrix& lhs, const SquareMatrix& rhs);
+	static SquareMatrix scale(const SquareMatrix& matrix, const T& scalar);
 
 private:
+	// Slow path of the SIMD kernels: recomputes the results (valueAt(i) is
+	// the exact, widened result at index i) and stores them as the policy
+	// decides; throws for the first invalid one with ThrowingRange
+	template <typename F>
+	void applyPolicy(F valueAt);
+
+	// exact type for recomputing a result on the slow path
+	static auto widen(const T& val)
+	{
+		if constexpr (std::is_integral_v<T>)
+			return static_cast<long long>(val);
+		else
+			return val;
+	}
+
+	std::size_t index(int i, int j) const
+	{
+		return static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size) + static_cast<std::size_t>(j);
+	}
+
 	int m_size;
-	std::vector<std::vector<T>> m_matrix;
+	std::vector<T, DefaultInitAllocator<T>> m_data;
+	[[no_unique_address]] typename Policy::Report m_report;
 };
 
-template <typename T>
-const T& SquareMatrix<T>::operator()(int i, int j) const
+template <typename T, typename Policy>
+const T& SquareMatrix<T, Policy>::operator()(int i, int j) const
 {
-	return m_matrix[i][j];
+	return m_data[index(i, j)];
 }
 
-template <typename T>
-T& SquareMatrix<T>::operator()(int i, int j)
+template <typename T, typename Policy>
+T& SquareMatrix<T, Policy>::operator()(int i, int j)
 {
-	return m_matrix[i][j];
+	return m_data[index(i, j)];
 }
 
-inline std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<int>& matrix)
+template <typename T, typename Policy>
+std::ostream& operator<<(std::ostream& ostr, const SquareMatrix<T, Policy>& matrix)
 {
-	for (int i = 0; i < matrix.size(); ++i)
-	{
-		for (int j = 0; j < matrix.size(); ++j)
-		{
-			ostr << matrix(i, j) << ' ';
-		}
-		ostr << '\n';
-	}
+	// one buffer per thread: the batch evaluation formats results in parallel
+	thread_local auto formatter = MatrixFormatter();
+	formatter.write(ostr, MatrixView<T>(matrix.data(), matrix.size()));
 	return ostr;
 }
 
-inline std::istream& operator>>(std::istream& istr, SquareMatrix<int>& matrix)
+template <typename T, typename Policy>
+std::istream& operator>>(std::istream& istr, SquareMatrix<T, Policy>& matrix)
 {
-	for (int i = 0; i < matrix.size(); ++i)
+	T* data = matrix.data();
+	for (std::size_t i = 0; i < matrix.count(); ++i)
 	{
-		for (int j = 0; j < matrix.size(); ++j)
-		{
-			int val;
-			istr >> val;
+		T val;
+		istr >> val;
 
-			matrix.checkVal(val);
-			matrix(i, j) = val;
-		}
+		data[i] = matrix.checked(val);
 	}
 	return istr;
 }
 
 // Implementation must be in .h file for the compiler to see it and instantiate
 // the relevant function
-template <typename T>
-SquareMatrix<T>::SquareMatrix(int size, const T& value)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(int size, const T& value)
 {
 	checkSize(size);
-	checkVal(value);
 
 	m_size = size;
-	m_matrix = std::vector<std::vector<T>>(size, std::vector<T>(size, value));
+	m_data.assign(index(size, 0), checked(value));
 }
 
-template <typename T>
-SquareMatrix<T>::SquareMatrix(int size)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(int size, NoFill)
+{
+	checkSize(size);
+	m_size = size;
+	m_data.resize(index(size, 0));
+}
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(const MatrixView<T>& view)
+	: SquareMatrix(view.size(), NoFill())
+{
+	std::copy(view.data(), view.data() + view.count(), m_data.begin());
+}
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>::SquareMatrix(int size)
 
 {
 	checkSize(size);
 	m_size = size;
-	m_matrix = std::vector<std::vector<T>>(size, std::vector<T>(size));
+	m_data.resize(index(size, 0));
 
-	for (int i = 0; i < size * size; ++i)
+	for (std::size_t i = 0; i < m_data.size(); ++i)
 	{
-		m_matrix[i / size][i % size] = static_cast<T>(i);
+		m_data[i] = static_cast<T>(i);
 	}
 }
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator+(const SquareMatrix& rhs) const
+template <typename T, typename Policy>
+template <MatrixExpressionType E>
+SquareMatrix<T, Policy>::SquareMatrix(const E& expr)
+	: SquareMatrix(expr.size(), NoFill())
 {
-	SquareMatrix result(m_size); // ????? ?????? ????? ????
-
-	for (int i = 0; i < m_size; ++i)
+	auto valid = true;
+	for (std::size_t begin = 0; begin < m_data.size(); begin += MATRIX_EXPRESSION_TILE)
 	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			T sum = m_matrix[i][j] + rhs.m_matrix[i][j];
-			checkVal(sum);
-			result(i, j) = sum;
-		}
+		// the root node writes straight into this matrix; a plain leaf returns its own values
+		const auto length = std::min(MATRIX_EXPRESSION_TILE, m_data.size() - begin);
+		T* destination = m_data.data() + begin;
+		const T* values = expr.tile(begin, length, destination, valid);
+		if (values != destination)
+			std::copy(values, values + length, destination);
 	}
-	return result;
+
+	if (!valid)
+		*this = expr.materialize(); // applies the policy to every invalid intermediate
+	else
+		m_report = expr.report();
 }
 
+template <typename T, typename Policy>
+template <MatrixExpressionType E>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator=(const E& expr)
+{
+	// evaluate into a new buffer: the expression may read this matrix
+	return *this = SquareMatrix(expr);
+}
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator-(const SquareMatrix& rhs) const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::add(const SquareMatrix& lhs, const SquareMatrix& rhs)
 {
-	SquareMatrix result(m_size); // ????? ?????? ????? ????
+	SquareMatrix result(lhs.m_size, NoFill());
+	result.m_report = lhs.m_report;
+	result.m_report.merge(rhs.m_report);
+	if constexpr (!Policy::checks)
+		kernels::add(lhs.data(), rhs.data(), result.data(), result.count());
+	else if (!kernels::addInRange(lhs.data(), rhs.data(), result.data(), result.count(), T(MIN_ALLOWED_VALU), T(MAX_ALLOWED_VALUE)))
+		result.applyPolicy([&](std::size_t i) { return widen(lhs.m_data[i]) + widen(rhs.m_data[i]); });
+	return result;
+}
 
-	for (int i = 0; i < m_size; ++i)
-	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			T sum = m_matrix[i][j] - rhs.m_matrix[i][j];
-			checkVal(sum);
-			result(i, j) = sum;
-		}
-	}
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::sub(const SquareMatrix& lhs, const SquareMatrix& rhs)
+{
+	SquareMatrix result(lhs.m_size, NoFill());
+	result.m_report = lhs.m_report;
+	result.m_report.merge(rhs.m_report);
+	if constexpr (!Policy::checks)
+		kernels::sub(lhs.data(), rhs.data(), result.data(), result.count());
+	else if (!kernels::subInRange(lhs.data(), rhs.data(), result.data(), result.count(), T(MIN_ALLOWED_VALU), T(MAX_ALLOWED_VALUE)))
+		result.applyPolicy([&](std::size_t i) { return widen(lhs.m_data[i]) - widen(rhs.m_data[i]); });
 	return result;
 }
 
-template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator+=(const SquareMatrix& rhs)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator+=(const SquareMatrix& rhs)
 {
 	return *this = *this + rhs;
 }
 
-template <typename T>
-SquareMatrix<T>& SquareMatrix<T>::operator-=(const SquareMatrix& rhs)
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator-=(const SquareMatrix& rhs)
 {
 
 	return *this = *this - rhs;
 }
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::Transpose() const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy>& SquareMatrix<T, Policy>::operator*=(const SquareMatrix& rhs)
+{
+	return *this = *this * rhs;
+}
+
+// Blocked multiply (see kernels::gemm). The inner loop does no range checks;
+// all the products are validated together once the result is complete.
+// Without checks (UncheckedRange) the products are accumulated in T.
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::operator*(const SquareMatrix& rhs) const
 {
-	SquareMatrix result(m_size);
-	for (int i = 0; i < m_size; ++i)
+	SquareMatrix result(m_size, NoFill());
+	result.m_report = m_report;
+	result.m_report.merge(rhs.m_report);
+
+	if constexpr (std::is_integral_v<T> && Policy::checks)
 	{
-		for (int j = 0; j < m_size; ++j)
+		// bound every dot product, and accumulate in T only if none can overflow
+		T lo, hi, rhsLo, rhsHi;
+		kernels::minMax(data(), count(), lo, hi);
+		kernels::minMax(rhs.data(), rhs.count(), rhsLo, rhsHi);
+		const auto magnitude = [](T a, T b) { return std::max(std::abs(static_cast<double>(a)), std::abs(static_cast<double>(b))); };
+		const auto bound = magnitude(lo, hi) * magnitude(rhsLo, rhsHi) * m_size;
+
+		if (bound > static_cast<double>(std::numeric_limits<T>::max()))
 		{
-			result(i, j) = m_matrix[j][i];
+			auto wide = std::vector<long long>(count());
+			kernels::gemm(m_size, data(), rhs.data(), wide.data());
+
+			long long wideLo, wideHi;
+			kernels::minMax(wide.data(), wide.size(), wideLo, wideHi);
+			if (wideLo <= MIN_ALLOWED_VALU || wideHi >= MAX_ALLOWED_VALUE)
+				result.applyPolicy([&](std::size_t i) { return wide[i]; });
+			else
+				std::ranges::transform(wide, result.m_data.begin(), [](long long val) { return static_cast<T>(val); });
+			return result;
 		}
 	}
+
+	if constexpr (std::is_same_v<T, int>)
+		kernels::gemmInt(m_size, data(), rhs.data(), result.data());
+	else if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>)
+		kernels::gemmFloat(m_size, data(), rhs.data(), result.data());
+	else
+		kernels::gemm(m_size, data(), rhs.data(), result.data());
+
+	if constexpr (Policy::checks)
+	{
+		T lo, hi;
+		kernels::minMax(result.data(), result.count(), lo, hi);
+		if (lo <= MIN_ALLOWED_VALU || hi >= MAX_ALLOWED_VALUE)
+			result.applyPolicy([&](std::size_t i) { return widen(result.m_data[i]); });
+	}
+	return result;
+}
+
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::Transpose() const
+{
+	SquareMatrix result(m_size, NoFill());
+	result.m_report = m_report;
+	kernels::transpose(m_size, data(), result.data());
 	return result;
 }
 
+template <typename T, typename Policy>
+void SquareMatrix<T, Policy>::transposeInPlace()
+{
+	kernels::transposeInPlace(m_size, data());
+}
+
 
-template <typename T>
-SquareMatrix<T> SquareMatrix<T>::operator*(const T& scalar) const
+template <typename T, typename Policy>
+SquareMatrix<T, Policy> SquareMatrix<T, Policy>::scale(const SquareMatrix& matrix, const T& scalar)
 {
-	SquareMatrix result(*this);
-	for (int i = 0; i < m_size; ++i)
+	SquareMatrix result(matrix.m_size, NoFill());
+	result.m_report = matrix.m_report;
+	if constexpr (!Policy::checks)
+		kernels::scale(matrix.data(), scalar, result.data(), result.count());
+	else if (!kernels::scaleInRange(matrix.data(), scalar, result.data(), result.count(), T(MIN_ALLOWED_VALU), T(MAX_ALLOWED_VALUE)))
+		result.applyPolicy([&](std::size_t i) { return widen(matrix.m_data[i]) * widen(scalar); });
+	return result;
+}
+
+template <typename T, typename Policy>
+template <typename F>
+void SquareMatrix<T, Policy>::applyPolicy(F valueAt)
+{
+	for (std::size_t i = 0; i < m_data.size(); ++i)
 	{
-		for (int j = 0; j < m_size; ++j)
-		{
-			T sum = m_matrix[i][j] * scalar;
-			checkVal(sum);
-			result(i, j) = sum;
-		}
+		m_data[i] = static_cast<T>(Policy::fix(valueAt(i), m_report));
 	}
-	return result;
 }
 
-template<typename T>
-inline void SquareMatrix<T>::checkVal(T val) const {
-	if (val <= MIN_ALLOWED_VALU || val >= MAX_ALLOWED_VALUE)
-		throw FileException("the value: " + std::to_string(val) + " ,is invalid value");
+template <typename T, typename Policy>
+inline void SquareMatrix<T, Policy>::checkVal(T val) {
+	if (!isInRange(val))
+		throw FileException("the value: " + valueText(val) + " ,is invalid value");
+}
+
+template <typename T, typename Policy>
+inline void SquareMatrix<T, Policy>::checkValues() const {
+	checkValues(MatrixView<T>(data(), m_size));
 }
 
-template<typename T>
-inline void SquareMatrix<T>::checkSize(int size) const {
-	if (size <= 0 || size >= MAX_MAT_SIZE)
+template <typename T, typename Policy>
+inline void SquareMatrix<T, Policy>::checkValues(const MatrixView<T>& view) {
+	T lo, hi;
+	kernels::minMax(view.data(), view.count(), lo, hi);
+	if (lo > MIN_ALLOWED_VALU && hi < MAX_ALLOWED_VALUE)
+		return;
+
+	std::for_each(view.data(), view.data() + view.count(), checkVal);
+}
+
+template <typename T, typename Policy>
+T SquareMatrix<T, Policy>::checked(T val)
+{
+	if constexpr (Policy::checks)
+		return static_cast<T>(Policy::fix(widen(val), m_report));
+	else
+		return val;
+}
+
+template <typename T, typename Policy>
+inline void SquareMatrix<T, Policy>::checkSize(int size) const {
+	if (size <= 0)
 		throw FileException("the size: " + std::to_string(size) + " ,is invalid size for SquareMatrix");
-}
\ No newline at end of file
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A fixed set of worker threads with one task deque per worker.
+//
+// A worker pushes and pops the tasks it creates at the back of its own
+// deque (newest first, while the data is still in cache) and, when it runs
+// out, steals the oldest task from the front of another deque - the oldest
+// tasks are the biggest subtrees. A thread that waits for a task it forked
+// runs other tasks meanwhile, so nested forks cannot deadlock, and sleeps
+// only while there is none to run. Threads outside the pool share one more
+// deque.
+class ThreadPool
+{
+public:
+    // workers: number of threads (at least 1)
+    explicit ThreadPool(int workers = defaultWorkerCount());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int workerCount() const { return static_cast<int>(m_workers.size()); }
+
+    // Runs first and second, possibly in parallel, and returns when both are
+    // done. If both throw, the exception of first is rethrown.
+    void invoke(const std::function<void()>& first, const std::function<void()>& second);
+
+    // Calls body(i) for every i in [0, count), splitting the range in halves
+    // with invoke(); the first exception thrown is rethrown
+    void forEach(std::size_t count, const std::function<void(std::size_t)>& body);
+
+    static int defaultWorkerCount();
+
+private:
+    struct Task
+    {
+        const std::function<void()>* work;
+        std::exception_ptr error;
+        std::atomic<bool> done = false;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task*> tasks;
+    };
+
+    void forEach(std::size_t begin, std::size_t end, const std::function<void(std::size_t)>& body);
+    void push(Task* task);
+    Task* take(); // own newest task, or the oldest of another queue
+    void execute(Task* task);
+    void work(std::size_t index);
+    std::size_t ownQueue() const;
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // one per worker, the last for other threads
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex; // for sleeping workers and waiters
+    std::condition_variable m_wake;
+    std::condition_variable m_finished; // a task is done
+    std::atomic<std::size_t> m_pending = 0;
+    bool m_stop = false;
+};
@@ -10,7 +10,10 @@ class Transpose : public UnaryOperation
 {
 public:
     using UnaryOperation::UnaryOperation;
-    T compute(const std::vector<T>& input) const override;
+    T compute(Input input) const override;
+    T consume(T input) const override;
+    std::optional<Term> term(Input input) const override;
+    Program::Value compile(Program::Builder& builder, std::span<const Program::Value> input) const override;
     void print(std::ostream& ostr, bool first_print = false) const override;
 
 };
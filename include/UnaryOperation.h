@@ -10,7 +10,5 @@ class UnaryOperation : public Operation
 public:
     UnaryOperation();
     int inputCount() const override;
-    ~UnaryOperation() override = 0
-    {
-    }
+    ~UnaryOperation() override = 0;
 };
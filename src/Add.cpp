@@ -3,15 +3,15 @@
 #include <iostream>
 
 
-Operation::T Add::compute(const std::vector<T>& input) const
+Operation::T Add::compute(Input input) const
 {
-    const auto a = first()->compute(input);
-    auto firstCount = first()->inputCount();
-	//remove the firstCount elements from the input vector, and put in a new vector
-	std::vector input2(input.begin() + firstCount, input.end());
-    const auto b = second()->compute(input2);
+    return combine(input, [](const Term& a, const Term& b) { return a + b; });
+}
+
 
-    return a + b;
+Program::Value Add::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    return compileElementwise(builder, input, Program::OpCode::Add);
 }
 
 
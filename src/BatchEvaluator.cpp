@@ -0,0 +1,186 @@
+#include "BatchEvaluator.h"
+#include "EvalCache.h"
+#include "ThreadPool.h"
+#include "FileException.h"
+#include "MatrixFile.h"
+#include "MatrixParser.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <optional>
+
+
+BatchEvaluator::BatchEvaluator(const Program& program, int size, ThreadPool* pool)
+    : m_program(program), m_size(size), m_pool(pool)
+{
+    if (size <= 0)
+        throw FileException("the size: " + std::to_string(size) + " ,is invalid size for SquareMatrix");
+}
+
+
+std::size_t BatchEvaluator::run(std::istream& istr, std::ostream& ostr) const
+{
+    const auto inputCount = static_cast<std::size_t>(m_program.inputCount());
+    auto chunk = std::vector<Program::T>();
+    auto results = std::vector<std::string>(BATCH_EVAL_CHUNK);
+    auto total = std::size_t(0);
+
+    auto parser = MatrixParser(istr, MatrixParser::Mode::Stream);
+    auto sets = std::size_t(0);
+    while (readChunk(parser, total, chunk, sets))
+    {
+        forEachSet(sets, [&](std::size_t set) {
+            results[set] = format(std::span<const Program::T>(chunk).subspan(set * inputCount, inputCount));
+        });
+
+        for (std::size_t set = 0; set < sets; ++set)
+            ostr << results[set];
+        total += sets;
+    }
+    ostr.flush();
+    return total;
+}
+
+
+std::size_t BatchEvaluator::run(const MatrixFile& file, std::ostream& ostr) const
+{
+    const auto inputCount = static_cast<std::size_t>(m_program.inputCount());
+    const auto input = views(file);
+    const auto total = input.size() / inputCount;
+    auto results = std::vector<std::string>(BATCH_EVAL_CHUNK);
+
+    for (std::size_t first = 0; first < total; first += BATCH_EVAL_CHUNK)
+    {
+        const auto sets = std::min(BATCH_EVAL_CHUNK, total - first);
+        forEachSet(sets, [&](std::size_t set) {
+            results[set] = format(std::span<const MatrixView<int>>(input).subspan((first + set) * inputCount, inputCount));
+        });
+
+        for (std::size_t set = 0; set < sets; ++set)
+            ostr << results[set];
+    }
+    ostr.flush();
+    return total;
+}
+
+
+std::size_t BatchEvaluator::run(const MatrixFile& file, MatrixFileWriter& writer) const
+{
+    const auto inputCount = static_cast<std::size_t>(m_program.inputCount());
+    const auto input = views(file);
+    const auto total = input.size() / inputCount;
+    auto results = std::vector<std::optional<Program::T>>(BATCH_EVAL_CHUNK);
+    auto errors = std::vector<std::string>(BATCH_EVAL_CHUNK);
+
+    for (std::size_t first = 0; first < total; first += BATCH_EVAL_CHUNK)
+    {
+        const auto sets = std::min(BATCH_EVAL_CHUNK, total - first);
+        forEachSet(sets, [&](std::size_t set) {
+            results[set].reset();
+            try
+            {
+                results[set] = evaluate(std::span<const MatrixView<int>>(input).subspan((first + set) * inputCount, inputCount));
+            }
+            catch (const FileException& e)
+            {
+                errors[set] = e.what();
+            }
+        });
+
+        for (std::size_t set = 0; set < sets; ++set)
+        {
+            if (!results[set])
+                throw FileException("input set #" + std::to_string(first + set + 1) + ": " + errors[set] + '\n');
+            writer.write(*results[set]);
+        }
+    }
+    writer.finish();
+    return total;
+}
+
+
+template <typename M>
+Program::T BatchEvaluator::evaluate(std::span<const M> input) const
+{
+    for (const auto& matrix : input)
+        SquareMatrix<int>::checkValues(MatrixView<int>(matrix.data(), matrix.size()));
+    // sets are evaluated in parallel, not the branches of one set
+    auto cache = EvalCache();
+    return m_program.run(input, &cache);
+}
+
+
+template <typename M>
+std::string BatchEvaluator::format(std::span<const M> input) const
+{
+    auto out = std::ostringstream();
+    try
+    {
+        out << evaluate(input);
+    }
+    catch (const FileException& e)
+    {
+        out << e.what() << '\n';
+    }
+    out << '\n';
+    return std::move(out).str();
+}
+
+
+template <typename F>
+void BatchEvaluator::forEachSet(std::size_t sets, F body) const
+{
+    if (m_pool && sets > 1)
+        m_pool->forEach(sets, body);
+    else
+        for (std::size_t set = 0; set < sets; ++set)
+            body(set);
+}
+
+
+std::vector<MatrixView<int>> BatchEvaluator::views(const MatrixFile& file) const
+{
+    const auto inputCount = static_cast<std::size_t>(m_program.inputCount());
+    if (file.size() != m_size)
+        throw FileException("the matrix file holds " + std::to_string(file.size()) + "x" + std::to_string(file.size())
+            + " matrices, not " + std::to_string(m_size) + "x" + std::to_string(m_size) + '\n');
+    if (file.count() % inputCount != 0)
+        throw FileException("the matrix file holds " + std::to_string(file.count())
+            + " matrices, not a whole number of sets of " + std::to_string(inputCount) + '\n');
+
+    auto result = std::vector<MatrixView<int>>();
+    result.reserve(file.count());
+    for (std::size_t i = 0; i < file.count(); ++i)
+        result.push_back(file.view(i));
+    return result;
+}
+
+
+bool BatchEvaluator::readChunk(MatrixParser& parser, std::size_t first, std::vector<Program::T>& chunk, std::size_t& sets) const
+{
+    const auto inputCount = static_cast<std::size_t>(m_program.inputCount());
+    chunk.clear();
+    sets = 0;
+
+    while (sets < BATCH_EVAL_CHUNK && !parser.atEnd())
+    {
+        for (std::size_t k = 0; k < inputCount; ++k)
+        {
+            // the values are checked with the set, so an invalid value is the error of its set only
+            auto matrix = Program::T(m_size, 0);
+            try
+            {
+                parser.read(matrix, false);
+            }
+            catch (const FileException& e)
+            {
+                throw FileException("input set #" + std::to_string(first + sets + 1) + ", " + e.what());
+            }
+            chunk.push_back(std::move(matrix));
+        }
+        ++sets;
+    }
+    return sets != 0;
+}
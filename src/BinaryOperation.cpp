@@ -3,12 +3,34 @@
 #include <iostream>
 
 
-BinaryOperation::BinaryOperation(const std::shared_ptr<Operation>& first, const std::shared_ptr<Operation>& second)
-    : m_first(first), m_second(second)
+BinaryOperation::BinaryOperation(const Operation& first, const Operation& second)
+    : m_first(&first), m_second(&second), m_firstCount(first.inputCount()), m_secondCount(second.inputCount())
 {
 }
 
 
+Operation::Structure BinaryOperation::structure() const
+{
+    return Structure{ typeid(*this), std::nullopt, { m_first->id(), m_second->id() } };
+}
+
+
+Program::Value BinaryOperation::compileElementwise(Program::Builder& builder, std::span<const Program::Value> input, Program::OpCode code) const
+{
+    // the children read disjoint inputs, so they may run in parallel
+    const auto fork = builder.fork();
+    auto a = builder.compile(*first(), input.first(static_cast<std::size_t>(firstCount())));
+    const auto mark = builder.split(fork);
+    const auto b = builder.compile(*second(), input.subspan(static_cast<std::size_t>(firstCount())));
+    if (a.checked() && builder.position() != mark + 1)
+    {
+        a = builder.plainAt(mark, a);
+    }
+    builder.join(fork);
+    return builder.emit(code, a, b);
+}
+
+
 void BinaryOperation::print(std::ostream& ostr, bool first_print ) const
 {
     if (!first_print)
@@ -0,0 +1,69 @@
+#include "BufferedOutput.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+BufferedOutput::BufferedOutput(std::ostream& target, std::size_t capacity)
+    : m_target(target), m_buffer(std::max<std::size_t>(capacity, 1))
+{
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+
+BufferedOutput::~BufferedOutput()
+{
+    sync();
+}
+
+
+BufferedOutput::int_type BufferedOutput::overflow(int_type ch)
+{
+    if (!drain())
+        return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+
+std::streamsize BufferedOutput::xsputn(const char* s, std::streamsize count)
+{
+    const auto size = static_cast<std::size_t>(count);
+    if (size > static_cast<std::size_t>(epptr() - pptr()))
+    {
+        if (!drain())
+            return 0;
+        // a block larger than the buffer goes straight to the target
+        if (size >= m_buffer.size())
+        {
+            m_target.write(s, count);
+            return m_target ? count : 0;
+        }
+    }
+    std::memcpy(pptr(), s, size);
+    pbump(static_cast<int>(count));
+    return count;
+}
+
+
+int BufferedOutput::sync()
+{
+    if (!drain())
+        return -1;
+    m_target.flush();
+    return m_target ? 0 : -1;
+}
+
+
+bool BufferedOutput::drain()
+{
+    const auto size = pptr() - pbase();
+    if (size > 0)
+        m_target.write(pbase(), size);
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return static_cast<bool>(m_target);
+}
@@ -5,17 +5,32 @@
 
 int Comp::inputCount() const
 {
-    return first()->inputCount() + second()->inputCount() - 1;
+    return firstCount() + secondCount() - 1;
 }
 
 
-Operation::T Comp::compute(const std::vector<T>& input) const
+Operation::T Comp::compute(Input input) const
 {
-    const auto resultOfFirst = first()->compute(input);
-    auto firstCount = first()->inputCount();
-    std::vector input2(input.begin() + firstCount, input.end());
-	input2.insert(input2.begin(), resultOfFirst);
-    return second()->compute(input2);
+    auto resultOfFirst = first()->compute(input);
+    if (secondCount() == 1)
+        return second()->consume(std::move(resultOfFirst));
+    return second()->compute(Input(resultOfFirst, secondInput(input)));
+}
+
+
+Program::Value Comp::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    const auto split = static_cast<std::size_t>(firstCount());
+    auto resultOfFirst = builder.compile(*first(), input.first(split));
+    // a scaled view is checked where it is read, which may be after instructions
+    // of the second operation: materialize it here to keep the error order
+    if (resultOfFirst.checked())
+    {
+        resultOfFirst = builder.plain(resultOfFirst);
+    }
+    auto input2 = std::vector<Program::Value>{ resultOfFirst };
+    input2.insert(input2.end(), input.begin() + static_cast<std::ptrdiff_t>(split), input.end());
+    return builder.compile(*second(), input2);
 }
 
 
@@ -0,0 +1,19 @@
+#include "Det.h"
+
+
+Operation::T Det::result(const LuFactorization<int>& factorization) const
+{
+    return factorization.determinant();
+}
+
+
+Program::OpCode Det::code() const
+{
+    return Program::OpCode::Det;
+}
+
+
+const char* Det::name() const
+{
+    return "det";
+}
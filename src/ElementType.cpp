@@ -0,0 +1,37 @@
+#include "ElementType.h"
+
+#include <array>
+#include <utility>
+
+
+namespace
+{
+    constexpr auto NAMES = std::array<std::pair<ElementType, std::string_view>, 4>{ {
+        { ElementType::Int, "int" },
+        { ElementType::Int64, "int64" },
+        { ElementType::Float, "float" },
+        { ElementType::Double, "double" },
+    } };
+}
+
+
+const char* elementTypeName(ElementType type)
+{
+    for (const auto& [value, name] : NAMES)
+    {
+        if (value == type)
+            return name.data();
+    }
+    return "int";
+}
+
+
+std::optional<ElementType> parseElementType(std::string_view name)
+{
+    for (const auto& [value, text] : NAMES)
+    {
+        if (text == name)
+            return value;
+    }
+    return std::nullopt;
+}
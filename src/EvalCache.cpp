@@ -0,0 +1,145 @@
+#include "EvalCache.h"
+
+#include <cstring>
+
+
+EvalCache::EvalCache(std::size_t capacity)
+    : m_capacity(capacity)
+{
+}
+
+
+std::shared_ptr<const void> EvalCache::findEntry(const Key& key)
+{
+    const auto lock = std::lock_guard(m_mutex);
+    const auto it = m_index.find(key);
+    if (it == m_index.end())
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    ++m_hits;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->second;
+}
+
+
+void EvalCache::insertEntry(const Key& key, std::shared_ptr<const void> result)
+{
+    const auto lock = std::lock_guard(m_mutex);
+    if (const auto it = m_index.find(key); it != m_index.end())
+    {
+        it->second->second = std::move(result);
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return;
+    }
+
+    m_entries.emplace_front(key, std::move(result));
+    m_index.emplace(key, m_entries.begin());
+}
+
+
+void EvalCache::endEval()
+{
+    // a factorization is shared within its eval only: it takes several
+    // times the memory of a result, which capacity() does not count
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        if (it->first.operation != LU_FACTORIZATION)
+        {
+            ++it;
+            continue;
+        }
+        m_index.erase(it->first);
+        it = m_entries.erase(it);
+    }
+    while (m_entries.size() > m_capacity)
+    {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+    }
+}
+
+
+void EvalCache::setCapacity(std::size_t capacity)
+{
+    m_capacity = capacity;
+    endEval();
+}
+
+
+void EvalCache::resetCounters()
+{
+    m_hits = 0;
+    m_misses = 0;
+}
+
+
+void EvalCache::clear()
+{
+    m_entries.clear();
+    m_index.clear();
+}
+
+
+std::uint64_t EvalCache::combine(std::uint64_t seed, std::uint64_t value)
+{
+    // 64-bit finalizer of MurmurHash3 applied to the mix of both values
+    auto h = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+
+EvalCache::Digest EvalCache::combine(const Digest& seed, std::uint64_t value)
+{
+    return { combine(seed.hash, value), combine(seed.check, value) };
+}
+
+
+EvalCache::Digest EvalCache::combine(const Digest& seed, const Digest& value)
+{
+    return { combine(seed.hash, value.hash), combine(seed.check, value.check) };
+}
+
+
+EvalCache::Digest EvalCache::digest(int size, const unsigned char* bytes, std::size_t length)
+{
+    // four independent multiply-xor lanes over 8 byte words per hash, folded
+    // at the end; the check lanes use another multiplier and shift, and both
+    // hashes are computed in the same pass over the values
+    constexpr std::uint64_t hashPrime = 0x9e3779b97f4a7c15ULL;
+    constexpr std::uint64_t checkPrime = 0xc2b2ae3d27d4eb4fULL;
+    std::uint64_t lanes[4] = { 1, 2, 3, 4 };
+    std::uint64_t checks[4] = { 5, 6, 7, 8 };
+
+    std::size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        for (std::size_t lane = 0; lane < 4; ++lane)
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + i + 8 * lane, sizeof(word));
+            lanes[lane] = (lanes[lane] ^ word) * hashPrime;
+            lanes[lane] ^= lanes[lane] >> 29;
+            checks[lane] = (checks[lane] + word) * checkPrime;
+            checks[lane] ^= checks[lane] >> 31;
+        }
+    }
+    auto result = Digest{ static_cast<std::uint64_t>(size), ~static_cast<std::uint64_t>(size) };
+    for (std::size_t lane = 0; lane < 4; ++lane)
+        result = combine(result, Digest{ lanes[lane], checks[lane] });
+    for (; i < length; i += 4)
+    {
+        // the element sizes are multiples of 4 bytes
+        std::uint32_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        result = combine(result, word);
+    }
+    return result;
+}
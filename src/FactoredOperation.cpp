@@ -0,0 +1,35 @@
+#include "FactoredOperation.h"
+
+#include <iostream>
+
+
+FactoredOperation::FactoredOperation(const Operation& base)
+    : m_base(&base), m_baseCount(base.inputCount())
+{
+}
+
+
+Operation::T FactoredOperation::compute(Input input) const
+{
+    return result(LuFactorization<int>(m_base->compute(input)));
+}
+
+
+Operation::Structure FactoredOperation::structure() const
+{
+    return Structure{ typeid(*this), std::nullopt, { m_base->id() } };
+}
+
+
+Program::Value FactoredOperation::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    return builder.emit(code(), builder.plain(builder.compile(*m_base, input)));
+}
+
+
+void FactoredOperation::print(std::ostream& ostr, bool) const
+{
+    ostr << name() << '(';
+    m_base->print(ostr, true);
+    ostr << ')';
+}
@@ -2,18 +2,36 @@
 #include "SquareMatrix.h"
 #include "Add.h"
 #include "Sub.h"
+#include "Mul.h"
 #include "Comp.h"
 #include "Identity.h"
 #include "Transpose.h"
 #include "Scalar.h"
+#include "Pow.h"
+#include "Det.h"
+#include "Inverse.h"
+#include "Solve.h"
 #include "InputException.h"
 #include "FileException.h"
+#include "BatchEvaluator.h"
+#include "MatrixFile.h"
+#include "MatrixParser.h"
+#include "Profiler.h"
+#include "ElementType.h"
 //#include "ReadFile.h"
 #include <iostream>
 #include <algorithm>
+#include <limits>
+#include <chrono>
+#include <unordered_map>
+#include <type_traits>
 
 FunctionCalculator::FunctionCalculator( std::ostream& ostr)
-    : m_actions(createActions()), m_operations(createOperations()), m_ostr(ostr) {}
+    : m_actions(createActions()), m_operations(createOperations()), m_ostr(ostr)
+{
+    if (ThreadPool::defaultWorkerCount() > 1)
+        m_pool = std::make_unique<ThreadPool>();
+}
 
 void FunctionCalculator::run()
 {
@@ -76,12 +94,76 @@ void FunctionCalculator::run(std::istream& istr, bool fileMode)
     } 
 }
 
+bool FunctionCalculator::runScript(std::istream& istr, ErrorPolicy policy)
+{
+    const auto outer = m_script;
+    m_script = policy;
+    // a script read from a script keeps the limit and the failures of its parent
+    if (!outer)
+    {
+        m_maxOperation = MAX_OPERATIONS;
+        m_scriptFailed = false;
+    }
+
+    auto line = std::string();
+    auto iss = std::istringstream();
+    auto command = 0;
+    auto ok = true;
+    while (m_running && std::getline(istr, line))
+    {
+        ++command;
+        iss.clear();
+        iss.str(line);
+        if (!hasNonWhitespace(iss))
+            continue;
+        try {
+            runAction(readAction(iss), iss, istr);
+        }
+        catch (const std::exception& e)
+        {
+            ok = false;
+            if (policy == ErrorPolicy::Skip)
+                continue;
+            auto message = std::string(e.what());
+            if (!message.ends_with('\n'))
+                message += '\n';
+            m_ostr << "Error in command #" << command << " '" << line << "': " << message;
+            if (policy == ErrorPolicy::Abort)
+                break;
+        }
+    }
+    m_ostr.flush();
+    m_script = outer;
+    return ok && !m_scriptFailed;
+}
+
+bool FunctionCalculator::run(const std::string& commands)
+{
+    m_maxOperation = MAX_OPERATIONS;
+    auto rest = std::istringstream(commands);
+    auto line = std::string();
+    while (m_running && std::getline(rest, line, ';'))
+    {
+        auto iss = std::istringstream(line);
+        if (!hasNonWhitespace(iss))
+            continue;
+        try {
+            runAction(readAction(iss), iss, std::cin);
+        }
+        catch (const std::exception& e)
+        {
+            m_ostr << "Error in '" << line << "': " << e.what() << '\n';
+            return false;
+        }
+    }
+    return true;
+}
+
 void FunctionCalculator::eval(std::istringstream& iss, std::istream& istr)
 {
     if (auto index = readOperationIndex(iss); index)
     {
-        const auto& operation = m_operations[*index];
-		int inputCount = operation->inputCount();
+        const auto& operation = m_nodes[m_operations[static_cast<std::size_t>(*index)]];
         int size = 0;
         iss >> size;
 		if (iss.fail())
@@ -91,35 +173,165 @@ void FunctionCalculator::eval(std::istringstream& iss, std::istream& istr)
 			throw InputException("Missing arguments for this command, there is no 'SIZE' argument for this command.");
 		}
 
+        auto type = ElementType::Int;
+        if (hasNonWhitespace(iss))
+        {
+            auto name = std::string();
+            iss >> name;
+            const auto parsed = parseElementType(name);
+            if (!parsed)
+                throw InputException("The element type must be int, int64, float or double.");
+            type = *parsed;
+        }
         if (hasNonWhitespace(iss))
             throw InputException("Too many arguments for this command");
 
-		auto matrixVec = std::vector<Operation::T>();
-        if (inputCount > 1)
-            m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
+        // the operation is compiled once; only its run depends on the type
+        visitElementType(type, [&]<typename E>(std::type_identity<E>) { evalAs<E>(operation, size, istr); });
+    }
+}
 
-		for (int i = 0; i < inputCount; ++i)
-		{
-            auto input = Operation::T(size); // Operation::T == SquareMatrix<int>
+template <typename E>
+void FunctionCalculator::evalAs(const Operation& operation, int size, std::istream& istr)
+{
+	int inputCount = operation.inputCount();
+	auto matrixVec = std::vector<SquareMatrix<E>>();
+    if (inputCount > 1 && !m_script)
+        m_ostr << "\nPlease enter " << inputCount << " matrices:\n";
+
+    // reads whole lines, so the rest of the last line of a matrix is dropped
+    auto parser = MatrixParser(istr, MatrixParser::Mode::Lines);
+	for (int i = 0; i < inputCount; ++i)
+	{
+        // every value is read into it
+        auto input = SquareMatrix<E>(size, typename SquareMatrix<E>::NoFill());
+        if (!m_script)
             m_ostr << "\nEnter a " << size << "x" << size << " matrix:\n";
-            istr >> input;
-			matrixVec.push_back(input);
-		}
-        istr.clear();
-        istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        parser.read(input);
+		matrixVec.push_back(std::move(input));
+	}
+
+    m_ostr << "\n";
+    if (m_echoInputs)
+        operation.print<E>(m_ostr, matrixVec);
+    else
+        operation.print(m_ostr);
+    m_ostr << " = \n" << operation.program().run(matrixVec, &m_cache, m_pool.get());
+}
+
+void FunctionCalculator::powFunc(std::istringstream& iss)
+{
+    if (auto index = readOperationIndex(iss); index)
+    {
+        int exponent = 0;
+        iss >> exponent;
+        if (iss.fail())
+            throw InputException("Missing arguments for this command, expected: pow num k");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+        addOperation(m_nodes.apply<Pow>(m_operations[static_cast<std::size_t>(*index)], exponent));
+    }
+}
+
+void FunctionCalculator::beval(std::istringstream& iss)
+{
+    if (auto index = readOperationIndex(iss); index)
+    {
+        int size = 0;
+        iss >> size;
+        auto inPath = std::string();
+        auto outPath = std::string();
+        iss >> inPath >> outPath;
+        if (iss.fail())
+            throw InputException("Missing arguments for this command, expected: beval num size infile outfile");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+
+        const auto binaryIn = MatrixFile::isMatrixFile(inPath);
+        const auto binaryOut = outPath.ends_with(MATRIX_FILE_EXTENSION);
+        if (binaryOut && !binaryIn)
+            throw InputException("Results are written as a matrix file only for a matrix file input (see convert)");
+
+        const auto evaluator = BatchEvaluator(m_nodes[m_operations[static_cast<std::size_t>(*index)]].program(), size, m_pool.get());
+        const auto start = std::chrono::steady_clock::now();
+        auto sets = std::size_t(0);
+        if (binaryIn)
+        {
+            // the input sets are read where they are mapped
+            const auto file = MatrixFile(inPath);
+            if (binaryOut)
+            {
+                auto writer = MatrixFileWriter(outPath, size);
+                sets = evaluator.run(file, writer);
+            }
+            else
+            {
+                auto out = std::ofstream(outPath);
+                if (!out.is_open())
+                    throw FileException("Cannot create the file. \n path: " + outPath + '\n');
+                sets = evaluator.run(file, out);
+            }
+        }
+        else
+        {
+            auto in = std::ifstream(inPath);
+            if (!in.is_open())
+                throw FileException("File not found. \n path: " + inPath + '\n');
+            auto out = std::ofstream(outPath);
+            if (!out.is_open())
+                throw FileException("Cannot create the file. \n path: " + outPath + '\n');
+            sets = evaluator.run(in, out);
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-        m_ostr << "\n";
-        operation->print(m_ostr, matrixVec);
-        m_ostr << " = \n" << operation->compute(matrixVec);
+        m_ostr << "Evaluated " << sets << " input sets into " << outPath << " in " << seconds << " s ("
+            << (seconds > 0 ? static_cast<double>(sets) / seconds : 0.0) << " sets/s)\n";
     }
 }
 
+void FunctionCalculator::convert(std::istringstream& iss)
+{
+    int size = 0;
+    iss >> size;
+    auto inPath = std::string();
+    auto outPath = std::string();
+    iss >> inPath >> outPath;
+    if (iss.fail())
+        throw InputException("Missing arguments for this command, expected: convert n infile outfile");
+    if (hasNonWhitespace(iss))
+        throw InputException("Too many arguments for this command");
+
+    const auto start = std::chrono::steady_clock::now();
+    auto count = std::size_t(0);
+    if (MatrixFile::isMatrixFile(inPath))
+    {
+        const auto file = MatrixFile(inPath);
+        if (file.size() != size)
+            throw FileException("the matrix file holds " + std::to_string(file.size()) + "x" + std::to_string(file.size())
+                + " matrices, not " + std::to_string(size) + "x" + std::to_string(size) + '\n');
+        auto out = std::ofstream(outPath);
+        if (!out.is_open())
+            throw FileException("Cannot create the file. \n path: " + outPath + '\n');
+        count = file.toText(out);
+    }
+    else
+    {
+        auto in = std::ifstream(inPath);
+        if (!in.is_open())
+            throw FileException("File not found. \n path: " + inPath + '\n');
+        count = MatrixFile::fromText(in, size, outPath);
+    }
+    const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    m_ostr << "Converted " << count << " matrices into " << outPath << " in " << seconds << " s\n";
+}
+
 void FunctionCalculator::del(std::istringstream& iss)
 {
 	// update the number of operations are leagelly -- ??? 
     if (auto i = readOperationIndex(iss); i)
     {
-        m_operations.erase(m_operations.begin() + *i);
+        removeOperations(static_cast<std::size_t>(*i), static_cast<std::size_t>(*i) + 1);
     }
 }
 
@@ -148,12 +360,21 @@ void FunctionCalculator::read(std::istringstream& iss)
     if (!file.is_open()){
 		throw FileException("File not found. \n path: " + file_path); // WARNING NOT CATCHING!!!
     }
-    run(file, true);
+    if (!m_script)
+        run(file, true);
+    else if (!runScript(file, *m_script))
+    {
+        if (*m_script == ErrorPolicy::Abort)
+            throw FileException("the script " + file_path + " was aborted\n");
+        // its errors are reported already, but the script that read it failed too
+        m_scriptFailed = true;
+    }
 }
 
 void FunctionCalculator::resize(std::istream& istr)
 {
-    m_ostr << "Enter the new maximum number of operations (between 2 and 100): \n";
+	if (!m_script)
+		m_ostr << "Enter the new maximum number of operations (between " << MIN_OPERATIONS << " and " << MAX_OPERATIONS << "): \n";
 	auto newMaxOperation = 0;
 	istr >> newMaxOperation;
 	if (istr.fail())
@@ -162,9 +383,14 @@ void FunctionCalculator::resize(std::istream& istr)
 		istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 		throw InputException("Invalid input. Please enter a number.");
 	}
-	if (newMaxOperation < 2 || newMaxOperation > 100)
+	if (newMaxOperation < MIN_OPERATIONS || newMaxOperation > MAX_OPERATIONS)
 	{
-		throw InputException("The number of operations must be between 2 and 100.");
+		throw InputException("The number of operations must be between " + std::to_string(MIN_OPERATIONS) + " and " + std::to_string(MAX_OPERATIONS) + ".");
+	}
+	if (newMaxOperation < static_cast<int>(m_operations.size()) && m_script)
+	{
+		istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+		throw InputException("The new maximum number of operations is less than the current number of operations, delete some first.");
 	}
 	if (newMaxOperation < static_cast<int>(m_operations.size()))
 	{
@@ -174,14 +400,110 @@ void FunctionCalculator::resize(std::istream& istr)
 		std::cin >> choice;
 		if (choice == 'y' || choice == 'Y')
 		{
-			m_operations.resize(newMaxOperation);
+			removeOperations(static_cast<std::size_t>(newMaxOperation), m_operations.size());
 			m_ostr << "Excess operations deleted.\n";
 		}
 	}
+	// kept when the excess operations were not deleted
+	if (newMaxOperation >= static_cast<int>(m_operations.size()))
+		m_maxOperation = newMaxOperation;
     istr.clear();
     istr.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
+void FunctionCalculator::cache(std::istringstream& iss)
+{
+    if (hasNonWhitespace(iss))
+    {
+        int capacity = 0;
+        iss >> capacity;
+        if (iss.fail() || capacity < 0)
+            throw InputException("The cache capacity must be a non negative number.");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+        m_cache.setCapacity(static_cast<std::size_t>(capacity));
+    }
+
+    m_ostr << "Cache: " << m_cache.hits() << " hits, " << m_cache.misses() << " misses, "
+        << m_cache.size() << " entries, capacity " << m_cache.capacity() << "\n";
+}
+
+void FunctionCalculator::threads(std::istringstream& iss)
+{
+    if (hasNonWhitespace(iss))
+    {
+        int count = 0;
+        iss >> count;
+        if (iss.fail() || count < 1 || count > 256)
+            throw InputException("The number of threads must be between 1 and 256.");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+        m_pool.reset();
+        if (count > 1)
+            m_pool = std::make_unique<ThreadPool>(count);
+    }
+
+    m_ostr << "Threads: " << (m_pool ? m_pool->workerCount() : 1) << "\n";
+}
+
+void FunctionCalculator::echo(std::istringstream& iss)
+{
+    if (hasNonWhitespace(iss))
+    {
+        auto value = std::string();
+        iss >> value;
+        if (value != "on" && value != "off")
+            throw InputException("Expected on or off.");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+        m_echoInputs = value == "on";
+    }
+
+    m_ostr << "Echo of the inputs: " << (m_echoInputs ? "on" : "off") << "\n";
+}
+
+void FunctionCalculator::stats(std::istringstream& iss)
+{
+    auto path = std::string();
+    if (hasNonWhitespace(iss))
+    {
+        auto format = std::string();
+        iss >> format >> path;
+        if (format != "json" || path.empty())
+            throw InputException("Expected json and a file name.");
+        if (hasNonWhitespace(iss))
+            throw InputException("Too many arguments for this command");
+    }
+    if (!Profiler::Enabled)
+    {
+        m_ostr << "Statistics are not recorded in this build (build with OOP2_PROFILE).\n";
+        return;
+    }
+
+    // the operations of the list are named by their (first) number
+    auto numbers = std::unordered_map<std::uint64_t, std::size_t>();
+    for (std::size_t i = m_operations.size(); i-- > 0;)
+        numbers[m_nodes[m_operations[i]].id()] = i;
+    auto stats = Profiler::snapshot();
+    for (auto& entry : stats)
+    {
+        if (const auto it = numbers.find(entry.operation); it != numbers.end())
+            entry.name = std::to_string(it->second) + ". " + entry.name;
+    }
+    Profiler::reset();
+
+    if (path.empty())
+    {
+        Profiler::writeTable(m_ostr, stats);
+        return;
+    }
+    auto out = std::ofstream(path);
+    if (!out.is_open())
+        throw FileException("Cannot create the file. \n path: " + path + '\n');
+    Profiler::writeJson(out, stats);
+    m_ostr << "Statistics of " << stats.size() << " operations written to " << path << "\n";
+}
+
 void FunctionCalculator::printOperations() const
 {
 	// print number of operations are leagelly
@@ -190,7 +512,7 @@ void FunctionCalculator::printOperations() const
     for (decltype(m_operations.size()) i = 0; i < m_operations.size(); ++i)
     {
         m_ostr << i << ". ";
-        m_operations[i]->print(m_ostr,true);
+        m_nodes[m_operations[i]].print(m_ostr,true);
         m_ostr << '\n';
     }
     m_ostr << "\n Enter command ('help' for the list of available commands): ";
@@ -247,9 +569,16 @@ void FunctionCalculator::runAction(Action action , std::istringstream& iss , std
             break;
 
         case Action::Eval:     eval(iss, istr);                 break;
+        case Action::BatchEval: beval(iss);                     break;
+        case Action::Convert:  convert(iss);                    break;
         case Action::Add:      binaryFunc<Add>(iss);            break;
         case Action::Sub:      binaryFunc<Sub>(iss);            break;
+        case Action::Mul:      binaryFunc<Mul>(iss);            break;
         case Action::Comp:     binaryFunc<Comp>(iss);           break;
+        case Action::Pow:      powFunc(iss);                    break;
+        case Action::Det:      factoredFunc<Det>(iss);          break;
+        case Action::Inv:      factoredFunc<Inverse>(iss);      break;
+        case Action::Solve:    binaryFunc<Solve>(iss);          break;
         case Action::Del:      del(iss);                        break;
         case Action::Help:     help();                          break;
         case Action::Exit:     exit();                          break;
@@ -258,6 +587,10 @@ void FunctionCalculator::runAction(Action action , std::istringstream& iss , std
         case Action::Scal:     unaryWithIntFunc<Scalar>(iss);   break;
         case Action::Read:     read(iss);                       break;
         case Action::Resize:   resize(istr);                    break;
+        case Action::Cache:    cache(iss);                      break;
+        case Action::Threads:  threads(iss);                    break;
+        case Action::Echo:     echo(iss);                       break;
+        case Action::Stats:    stats(iss);                      break;
     }
 }
 
@@ -267,10 +600,23 @@ FunctionCalculator::ActionMap FunctionCalculator::createActions() const
     {
         {
             "eval",
-            "(uate) num n - compute the result of function #num on an nn matrix "
-			"(that will be prompted)",
+            "(uate) num n [type] - compute the result of function #num on an nn matrix "
+			"(that will be prompted) of type int (the default), int64, float or double",
             Action::Eval
         },
+        {
+            "beval",
+            " num n infile outfile - compute the result of function #num for every set of "
+			"nn input matrices in infile, in parallel, and write the results to outfile in order",
+            Action::BatchEval
+        },
+        {
+            "convert",
+            " n infile outfile - convert the nn matrices of a text file (as typed for beval) into a "
+			"binary matrix file, or a matrix file back into text. beval reads a matrix file without "
+			"parsing it, and writes its results as one when outfile ends with " + MATRIX_FILE_EXTENSION,
+            Action::Convert
+        },
         {
             "scal",
             "(ar) val - creates an operation that multiplies the "
@@ -289,12 +635,41 @@ FunctionCalculator::ActionMap FunctionCalculator::createActions() const
 			"and the result of operation #num2",
             Action::Sub
         },
+        {
+            "mul",
+            " num1 num2 - creates an operation that is the multiplication of the result of operation #num1 "
+			"and the result of operation #num2",
+            Action::Mul
+        },
         {
             "comp",
             "(osite) num1 num2 - creates an operation that is the composition of operation #num1 "
 			"and operation #num2",
             Action::Comp
         },
+        {
+            "pow",
+            " num k - creates an operation that raises the result of operation #num to the "
+			"power k (k >= 1), in O(log k) multiplications",
+            Action::Pow
+        },
+        {
+            "det",
+            " num - creates an operation that is the determinant of the result of operation #num "
+			"(times the identity matrix)",
+            Action::Det
+        },
+        {
+            "inv",
+            " num - creates an operation that is the inverse of the result of operation #num",
+            Action::Inv
+        },
+        {
+            "solve",
+            " num1 num2 - creates an operation that solves (result of #num1) * X = (result of #num2) "
+			"for X",
+            Action::Solve
+        },
         {
             "del",
             "(ete) num - delete operation #num from the operation list",
@@ -319,16 +694,38 @@ FunctionCalculator::ActionMap FunctionCalculator::createActions() const
 			"resize",
             " num - change the maximum number of operations",
             Action::Resize
+        },
+        {
+            "cache",
+            " [num] - print the hits and misses of the result cache, or set it to keep "
+			"up to num results between evaluations (0 - within an evaluation only)",
+            Action::Cache
+        },
+        {
+            "threads",
+            " [num] - print or set the number of threads an evaluation may use",
+            Action::Threads
+        },
+        {
+            "echo",
+            " [on|off] - print or set whether eval prints the input matrices with the result",
+            Action::Echo
+        },
+        {
+            "stats",
+            " [json filename] - print the time, memory and element operations of every "
+			"operation evaluated since the last stats (or write them to the file as JSON)",
+            Action::Stats
         }
     };
 }
 
-FunctionCalculator::OperationList FunctionCalculator::createOperations() const
+FunctionCalculator::OperationList FunctionCalculator::createOperations()
 {
     return OperationList
     {
-        std::make_shared<Identity>(),
-        std::make_shared<Transpose>(),
+        m_nodes.emplace<Identity>(),
+        m_nodes.emplace<Transpose>(),
     };
 }
 
@@ -341,7 +738,7 @@ void FunctionCalculator::updateMaxFunc()
 {
     do {
         try {
-            m_ostr << "Enter the number of operations to be performed (between 2 and 100): ";
+            m_ostr << "Enter the number of operations to be performed (between " << MIN_OPERATIONS << " and " << MAX_OPERATIONS << "): ";
             std::cin >> m_maxOperation;
 
             // if the read operation failed (e.g. characters were entered instead of a number)
@@ -351,8 +748,8 @@ void FunctionCalculator::updateMaxFunc()
                 throw InputException("Invalid input. Please enter a number.");
             }
 
-            if (m_maxOperation < 2 || m_maxOperation > 100) {
-                throw InputException("The number of operations must be between 2 and 100.");
+            if (m_maxOperation < MIN_OPERATIONS || m_maxOperation > MAX_OPERATIONS) {
+                throw InputException("The number of operations must be between " + std::to_string(MIN_OPERATIONS) + " and " + std::to_string(MAX_OPERATIONS) + ".");
             }
 
             break;
@@ -365,12 +762,26 @@ void FunctionCalculator::updateMaxFunc()
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
 }
 
-void  FunctionCalculator::addOperation(std::shared_ptr<Operation> op)
+void  FunctionCalculator::addOperation(OperationHandle op)
 {
-    if (m_operations.size() > m_maxOperation)
+    if (m_maxOperation < 0 || m_operations.size() > static_cast<std::size_t>(m_maxOperation))
     {
+        m_nodes.release(op);
         throw InputException("Cannot add more operations: maximum limit of " + std::to_string(m_maxOperation));
     }
 
-    m_operations.push_back(std::move(op));
+    // an operation equal to an existing one is already that one (interned).
+    // It is compiled by its first eval, not here: a program has a register
+    // per input, and combining an operation with itself doubles its inputs,
+    // so a chain of such operations could not even be added if it compiled
+    m_operations.push_back(op);
+}
+
+void FunctionCalculator::removeOperations(std::size_t from, std::size_t to)
+{
+    // the nodes no other operation uses are freed with them, in O(1) each; the
+    // list itself shifts, as the operations after them are renumbered
+    for (auto i = from; i < to; ++i)
+        m_nodes.release(m_operations[i]);
+    m_operations.erase(m_operations.begin() + static_cast<std::ptrdiff_t>(from), m_operations.begin() + static_cast<std::ptrdiff_t>(to));
 }
@@ -3,12 +3,31 @@
 #include <iostream>
 
 
-Operation::T Identity::compute(const std::vector<T>& input) const
+Operation::T Identity::compute(Input input) const
 {
     return input.front();
 }
 
 
+Operation::T Identity::consume(T input) const
+{
+    return input;
+}
+
+
+std::optional<Operation::Term> Identity::term(Input input) const
+{
+    return Term(input.front());
+}
+
+
+Program::Value Identity::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    (void)builder;
+    return input.front();
+}
+
+
 void Identity::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
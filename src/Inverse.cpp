@@ -0,0 +1,19 @@
+#include "Inverse.h"
+
+
+Operation::T Inverse::result(const LuFactorization<int>& factorization) const
+{
+    return factorization.inverse();
+}
+
+
+Program::OpCode Inverse::code() const
+{
+    return Program::OpCode::Inverse;
+}
+
+
+const char* Inverse::name() const
+{
+    return "inv";
+}
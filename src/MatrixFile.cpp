@@ -0,0 +1,198 @@
+#include "MatrixFile.h"
+#include "FileException.h"
+#include "MatrixParser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+std::uint64_t MatrixFileHeader::strideFor(std::uint32_t size)
+{
+    const auto bytes = std::uint64_t(size) * size * sizeof(int);
+    return (bytes + MATRIX_FILE_ALIGNMENT - 1) / MATRIX_FILE_ALIGNMENT * MATRIX_FILE_ALIGNMENT;
+}
+
+
+MatrixFile::MatrixFile(const std::string& path)
+{
+#if defined(_WIN32)
+    auto file = std::ifstream(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw FileException("File not found. \n path: " + path + '\n');
+    m_length = static_cast<std::size_t>(file.tellg());
+    m_buffer.resize((m_length + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_buffer.data()), static_cast<std::streamsize>(m_length));
+    m_bytes = reinterpret_cast<const std::byte*>(m_buffer.data());
+#else
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw FileException("File not found. \n path: " + path + '\n');
+    struct stat status {};
+    if (::fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        m_length = static_cast<std::size_t>(status.st_size);
+        auto* mapping = ::mmap(nullptr, m_length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_bytes = static_cast<const std::byte*>(mapping);
+            // the payloads are read in order, one set after the other
+            ::madvise(mapping, m_length, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+    if (!m_bytes)
+        throw FileException("Cannot map the file. \n path: " + path + '\n');
+#endif
+
+    const auto invalid = [&](const std::string& reason) {
+        unmap(); // the destructor does not run when the constructor throws
+        return FileException("the file: " + path + " ,is not a valid matrix file (" + reason + ")\n");
+    };
+    if (m_length < sizeof(MatrixFileHeader))
+        throw invalid("no header");
+    std::memcpy(&m_header, m_bytes, sizeof(MatrixFileHeader));
+    if (std::memcmp(m_header.magic, MatrixFileHeader::Magic, sizeof(m_header.magic)) != 0)
+        throw invalid("bad magic");
+    if (m_header.version != MatrixFileHeader::Version)
+        throw invalid("version " + std::to_string(m_header.version));
+    if (m_header.elementType != MatrixFileHeader::ElementType::Int32 || m_header.elementSize != sizeof(int))
+        throw invalid("unsupported element type");
+    if (m_header.size == 0 || m_header.stride != MatrixFileHeader::strideFor(m_header.size))
+        throw invalid("bad size");
+    if (m_header.count > (m_length - sizeof(MatrixFileHeader)) / m_header.stride)
+        throw invalid("truncated");
+}
+
+
+MatrixFile::~MatrixFile()
+{
+    unmap();
+}
+
+
+void MatrixFile::unmap()
+{
+#if !defined(_WIN32)
+    if (m_bytes)
+        ::munmap(const_cast<std::byte*>(m_bytes), m_length);
+#endif
+    m_bytes = nullptr;
+}
+
+
+bool MatrixFile::isMatrixFile(const std::string& path)
+{
+    auto file = std::ifstream(path, std::ios::binary);
+    char magic[sizeof(MatrixFileHeader::Magic)] = {};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, MatrixFileHeader::Magic, sizeof(magic)) == 0;
+}
+
+
+MatrixView<int> MatrixFile::view(std::size_t i) const
+{
+    const auto* payload = m_bytes + sizeof(MatrixFileHeader) + i * m_header.stride;
+    return MatrixView<int>(reinterpret_cast<const int*>(payload), size());
+}
+
+
+std::size_t MatrixFile::fromText(std::istream& text, int size, const std::string& path)
+{
+    auto writer = MatrixFileWriter(path, size);
+    auto parser = MatrixParser(text, MatrixParser::Mode::Stream);
+    auto matrix = SquareMatrix<int>(size, 0);
+    while (!parser.atEnd())
+    {
+        try
+        {
+            parser.read(matrix, false);
+        }
+        catch (const FileException& e)
+        {
+            throw FileException("matrix #" + std::to_string(writer.count() + 1) + ", " + e.what());
+        }
+        writer.write(matrix);
+    }
+    writer.finish();
+    return writer.count();
+}
+
+
+std::size_t MatrixFile::toText(std::ostream& text) const
+{
+    auto formatter = MatrixFormatter();
+    for (std::size_t i = 0; i < count(); ++i)
+    {
+        formatter.write(text, view(i));
+        text << '\n';
+    }
+    return count();
+}
+
+
+MatrixFileWriter::MatrixFileWriter(const std::string& path, int size)
+    : m_path(path), m_file(path, std::ios::binary | std::ios::trunc)
+{
+    if (size <= 0)
+        throw FileException("the size: " + std::to_string(size) + " ,is invalid size for SquareMatrix");
+    if (!m_file.is_open())
+        throw FileException("Cannot create the file. \n path: " + path + '\n');
+
+    std::memcpy(m_header.magic, MatrixFileHeader::Magic, sizeof(m_header.magic));
+    m_header.version = MatrixFileHeader::Version;
+    m_header.elementType = MatrixFileHeader::ElementType::Int32;
+    m_header.elementSize = sizeof(int);
+    m_header.size = static_cast<std::uint32_t>(size);
+    m_header.stride = MatrixFileHeader::strideFor(m_header.size);
+    // written again with the count by finish()
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+}
+
+
+MatrixFileWriter::~MatrixFileWriter()
+{
+    try
+    {
+        finish();
+    }
+    catch (const FileException&)
+    {
+    }
+}
+
+
+void MatrixFileWriter::write(const MatrixView<int>& matrix)
+{
+    if (matrix.size() != static_cast<int>(m_header.size))
+        throw FileException("a " + std::to_string(matrix.size()) + "x" + std::to_string(matrix.size())
+            + " matrix cannot be written to the matrix file " + m_path + '\n');
+
+    static constexpr char padding[MATRIX_FILE_ALIGNMENT] = {};
+    const auto bytes = matrix.count() * sizeof(int);
+    m_file.write(reinterpret_cast<const char*>(matrix.data()), static_cast<std::streamsize>(bytes));
+    m_file.write(padding, static_cast<std::streamsize>(m_header.stride - bytes));
+    ++m_header.count;
+}
+
+
+void MatrixFileWriter::finish()
+{
+    if (m_finished)
+        return;
+    m_finished = true;
+    m_file.seekp(0);
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_file.close();
+    if (m_file.fail())
+        throw FileException("Cannot write the file. \n path: " + m_path + '\n');
+}
@@ -0,0 +1,76 @@
+#include "MatrixFormatter.h"
+
+#include <charconv>
+#include <limits>
+#include <ostream>
+
+
+namespace
+{
+    // characters of the longest value of T that to_chars writes
+    template <typename T>
+    constexpr std::size_t maxLength()
+    {
+        if constexpr (std::numeric_limits<T>::is_integer)
+            return std::size_t(std::numeric_limits<T>::digits10) + 2;
+        else // sign, digits, point and exponent
+            return std::size_t(std::numeric_limits<T>::max_digits10) + 8;
+    }
+}
+
+
+std::string_view MatrixFormatter::format(const MatrixView<int>& matrix)
+{
+    return render(matrix);
+}
+
+
+std::string_view MatrixFormatter::format(const MatrixView<std::int64_t>& matrix)
+{
+    return render(matrix);
+}
+
+
+std::string_view MatrixFormatter::format(const MatrixView<float>& matrix)
+{
+    return render(matrix);
+}
+
+
+std::string_view MatrixFormatter::format(const MatrixView<double>& matrix)
+{
+    return render(matrix);
+}
+
+
+template <typename T>
+std::string_view MatrixFormatter::render(const MatrixView<T>& matrix)
+{
+    // the longest value and a space per value, and a new line per row
+    constexpr auto maxValue = maxLength<T>() + 1;
+    const auto size = static_cast<std::size_t>(matrix.size());
+    const auto capacity = matrix.count() * maxValue + size;
+    if (m_buffer.size() < capacity)
+        m_buffer.resize(capacity);
+
+    auto* out = m_buffer.data();
+    auto* const end = m_buffer.data() + m_buffer.size();
+    for (int i = 0; i < matrix.size(); ++i)
+    {
+        const T* row = matrix.row(i);
+        for (std::size_t j = 0; j < size; ++j)
+        {
+            // + 0 turns a negative zero into 0 (and leaves an int as it is)
+            out = std::to_chars(out, end, row[j] + T()).ptr;
+            *out++ = ' ';
+        }
+        *out++ = '\n';
+    }
+    return std::string_view(m_buffer.data(), static_cast<std::size_t>(out - m_buffer.data()));
+}
+
+
+void MatrixFormatter::write(std::ostream& ostr, std::string_view text)
+{
+    ostr.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
@@ -0,0 +1,162 @@
+#include "MatrixParser.h"
+#include "FileException.h"
+
+#include <charconv>
+#include <cstring>
+#include <istream>
+
+
+namespace
+{
+    // tokens longer than this cannot be a number in range
+    constexpr std::size_t MAX_TOKEN = 64;
+
+    bool isSpace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+}
+
+
+MatrixParser::MatrixParser(std::istream& istr, Mode mode)
+    : m_istr(istr), m_mode(mode)
+{
+    if (m_mode == Mode::Stream)
+        m_buffer.resize(MATRIX_PARSER_CHUNK + MAX_TOKEN);
+}
+
+
+void MatrixParser::read(int* out, std::size_t count, bool checkRange)
+{
+    readValues(out, count, checkRange);
+}
+
+
+void MatrixParser::read(std::int64_t* out, std::size_t count, bool checkRange)
+{
+    readValues(out, count, checkRange);
+}
+
+
+void MatrixParser::read(float* out, std::size_t count, bool checkRange)
+{
+    readValues(out, count, checkRange);
+}
+
+
+void MatrixParser::read(double* out, std::size_t count, bool checkRange)
+{
+    readValues(out, count, checkRange);
+}
+
+
+template <typename T>
+void MatrixParser::readValues(T* out, std::size_t count, bool checkRange)
+{
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (atEnd())
+            throw FileException("line " + std::to_string(m_line) + ": the input ended after "
+                + std::to_string(i) + " of " + std::to_string(count) + " values\n");
+        ensureToken();
+
+        const auto* first = m_buffer.data() + m_begin;
+        const auto* last = m_buffer.data() + m_end;
+        // operator>> accepts a leading '+', from_chars does not
+        if (*first == '+' && first + 1 < last && ((*(first + 1) >= '0' && *(first + 1) <= '9') || *(first + 1) == '.'))
+            ++first;
+
+        T val = 0;
+        const auto [ptr, ec] = std::from_chars(first, last, val);
+        if (ec == std::errc::result_out_of_range)
+            throw FileException(where() + "the value: " + token() + " ,is invalid value\n");
+        if (ec != std::errc() || (ptr != last && !isSpace(*ptr)))
+            throw FileException(where() + "'" + token() + "' is not a number\n");
+        // a floating point value may also be inf or nan, which are never in range
+        if (checkRange && !isInRange(val))
+            throw FileException(where() + "the value: " + valueText(val) + " ,is invalid value\n");
+
+        out[i] = val;
+        m_begin = static_cast<std::size_t>(ptr - m_buffer.data());
+    }
+}
+
+
+bool MatrixParser::atEnd()
+{
+    while (true)
+    {
+        for (; m_begin < m_end; ++m_begin)
+        {
+            const auto c = m_buffer[m_begin];
+            if (!isSpace(c))
+                return false;
+            if (c == '\n')
+            {
+                ++m_line;
+                m_lineStart = m_offset + m_begin + 1;
+            }
+        }
+        if (!refill())
+            return true;
+    }
+}
+
+
+bool MatrixParser::refill()
+{
+    if (m_eof)
+        return false;
+
+    if (m_mode == Mode::Lines)
+    {
+        // a line is only read when the previous one is used up
+        m_offset += m_end;
+        m_begin = m_end = 0;
+        if (!std::getline(m_istr, m_text))
+        {
+            m_eof = true;
+            return false;
+        }
+        m_text += '\n';
+        m_buffer.assign(m_text.begin(), m_text.end());
+        m_end = m_buffer.size();
+        return true;
+    }
+
+    // keep the characters not parsed yet at the front
+    const auto kept = m_end - m_begin;
+    std::memmove(m_buffer.data(), m_buffer.data() + m_begin, kept);
+    m_offset += m_begin;
+    m_begin = 0;
+    m_end = kept;
+
+    m_istr.read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_buffer.size() - m_end));
+    const auto count = static_cast<std::size_t>(m_istr.gcount());
+    m_end += count;
+    if (count == 0)
+        m_eof = true;
+    return count != 0;
+}
+
+
+void MatrixParser::ensureToken()
+{
+    if (m_mode == Mode::Stream && m_end - m_begin < MAX_TOKEN)
+        refill();
+}
+
+
+std::string MatrixParser::token() const
+{
+    auto end = m_begin;
+    while (end < m_end && end - m_begin < MAX_TOKEN && !isSpace(m_buffer[end]))
+        ++end;
+    return std::string(m_buffer.data() + m_begin, m_buffer.data() + end);
+}
+
+
+std::string MatrixParser::where() const
+{
+    return "line " + std::to_string(line()) + ", column " + std::to_string(column()) + ": ";
+}
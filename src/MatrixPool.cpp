@@ -0,0 +1,138 @@
+#include "MatrixPool.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <utility>
+
+
+namespace
+{
+    constexpr std::size_t MIN_BLOCK = 64;
+    // class 0 is up to MIN_BLOCK, then four classes per power of two up to MATRIX_POOL_MAX_BLOCK
+    constexpr std::size_t CLASS_COUNT = 4 * (std::bit_width(MATRIX_POOL_MAX_BLOCK) - std::bit_width(MIN_BLOCK)) + 1;
+
+    // the class of a buffer of bytes and the size of its blocks
+    std::pair<std::size_t, std::size_t> classOf(std::size_t bytes)
+    {
+        if (bytes <= MIN_BLOCK)
+            return { 0, MIN_BLOCK };
+        // high < bytes <= 2 * high, split in four steps
+        const auto high = std::bit_floor(bytes - 1);
+        const auto step = high / 4;
+        const auto quarters = (bytes - high + step - 1) / step;
+        const auto octave = static_cast<std::size_t>(std::bit_width(high) - std::bit_width(MIN_BLOCK));
+        return { 4 * octave + quarters, high + quarters * step };
+    }
+
+    // the size of the blocks of class index
+    std::size_t classSize(std::size_t index)
+    {
+        if (index == 0)
+            return MIN_BLOCK;
+        const auto high = MIN_BLOCK << ((index - 1) / 4);
+        return high + ((index - 1) % 4 + 1) * (high / 4);
+    }
+
+    struct Block
+    {
+        Block* next;
+    };
+
+    struct Pool
+    {
+        std::array<Block*, CLASS_COUNT> free{};
+        std::size_t retained = 0;
+
+        ~Pool();
+    };
+
+    std::atomic<bool> reuse{ true };
+    // set when the pool of the thread is gone, for matrices freed after it
+    // (e.g. by static destructors)
+    thread_local bool destroyed = false;
+    thread_local Pool pool;
+
+    Pool::~Pool()
+    {
+        destroyed = true;
+        for (auto* head : free)
+        {
+            while (head)
+                ::operator delete(std::exchange(head, head->next));
+        }
+    }
+}
+
+
+void* MatrixPool::allocate(std::size_t bytes)
+{
+    if (bytes > MATRIX_POOL_MAX_BLOCK)
+        return ::operator new(bytes);
+
+    const auto [index, size] = classOf(bytes);
+    if (!destroyed && reuse.load(std::memory_order_relaxed))
+    {
+        if (auto* block = pool.free[index])
+        {
+            pool.free[index] = block->next;
+            pool.retained -= size;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+
+void MatrixPool::deallocate(void* p, std::size_t bytes) noexcept
+{
+    if (!p)
+        return;
+    if (bytes > MATRIX_POOL_MAX_BLOCK)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    const auto [index, size] = classOf(bytes);
+    if (destroyed || !reuse.load(std::memory_order_relaxed))
+    {
+        ::operator delete(p);
+        return;
+    }
+    // when the working set changes, the sizes used now win: free the blocks
+    // of the other classes, the largest first
+    for (auto other = CLASS_COUNT; other-- > 0 && pool.retained + size > MATRIX_POOL_MAX_BYTES;)
+    {
+        while (other != index && pool.free[other] && pool.retained + size > MATRIX_POOL_MAX_BYTES)
+        {
+            ::operator delete(std::exchange(pool.free[other], pool.free[other]->next));
+            pool.retained -= classSize(other);
+        }
+    }
+    if (pool.retained + size > MATRIX_POOL_MAX_BYTES)
+    {
+        ::operator delete(p);
+        return;
+    }
+    pool.free[index] = ::new (p) Block{ pool.free[index] };
+    pool.retained += size;
+}
+
+
+void MatrixPool::setEnabled(bool enabled)
+{
+    reuse.store(enabled, std::memory_order_relaxed);
+}
+
+
+bool MatrixPool::enabled()
+{
+    return reuse.load(std::memory_order_relaxed);
+}
+
+
+std::size_t MatrixPool::retainedBytes()
+{
+    return destroyed ? 0 : pool.retained;
+}
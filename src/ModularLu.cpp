@@ -0,0 +1,538 @@
+#include "ModularLu.h"
+#include "SquareMatrix.h"
+#include "FileException.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+
+
+namespace
+{
+    // products of residues are below 2^58, so 32 of them add up in 64 bits
+    constexpr int DELAY = 32;
+    constexpr std::uint32_t PRIME_LIMIT = std::uint32_t(1) << 29;
+    constexpr std::size_t PRIME_COUNT = 1024;
+
+    std::uint32_t multiply(std::uint32_t a, std::uint32_t b, std::uint32_t p)
+    {
+        return static_cast<std::uint32_t>(std::uint64_t(a) * b % p);
+    }
+
+    std::uint32_t power(std::uint32_t a, std::uint32_t k, std::uint32_t p)
+    {
+        auto result = std::uint32_t(1);
+        for (; k > 0; k >>= 1, a = multiply(a, a, p))
+        {
+            if (k & 1)
+                result = multiply(result, a, p);
+        }
+        return result;
+    }
+
+    std::uint32_t inverse(std::uint32_t a, std::uint32_t p)
+    {
+        return power(a, p - 2, p);
+    }
+
+    std::uint32_t residue(std::int64_t value, std::uint32_t p)
+    {
+        const auto r = value % static_cast<std::int64_t>(p);
+        return static_cast<std::uint32_t>(r < 0 ? r + p : r);
+    }
+
+    // deterministic Miller-Rabin: the bases 2, 7 and 61 decide every n below 2^32
+    bool isPrime(std::uint32_t n)
+    {
+        auto d = n - 1;
+        int s = 0;
+        for (; d % 2 == 0; d /= 2)
+            ++s;
+        for (const std::uint32_t base : { 2u, 7u, 61u })
+        {
+            auto x = power(base, d, n);
+            if (x == 1 || x == n - 1)
+                continue;
+            int i = 1;
+            for (; i < s && x != n - 1; ++i)
+                x = multiply(x, x, n);
+            if (x != n - 1)
+                return false;
+        }
+        return true;
+    }
+
+    // the primes below PRIME_LIMIT, largest first
+    std::uint32_t prime(std::size_t index)
+    {
+        static const auto primes = [] {
+            auto result = std::vector<std::uint32_t>();
+            for (auto n = PRIME_LIMIT - 1; result.size() < PRIME_COUNT; n -= 2)
+            {
+                if (isPrime(n))
+                    result.push_back(n);
+            }
+            return result;
+        }();
+        if (index >= primes.size())
+            throw FileException("the matrix is too large for exact arithmetic");
+        return primes[index];
+    }
+
+    // target[j] -= sum of coefficients[k] * rows[k][j] for k in [k0, k1),
+    // j in [j0, j1), modulo p; row k of rows starts at rows + k * stride
+    void subtractProducts(std::uint32_t* target, const std::uint32_t* coefficients, const std::uint32_t* rows, std::size_t stride,
+        int k0, int k1, int j0, int j1, std::uint32_t p, std::vector<std::uint64_t>& sums)
+    {
+        for (int begin = k0; begin < k1; begin += DELAY)
+        {
+            std::fill(sums.begin() + j0, sums.begin() + j1, std::uint64_t(0));
+            for (int k = begin; k < std::min(begin + DELAY, k1); ++k)
+            {
+                const std::uint64_t c = coefficients[k];
+                if (c == 0)
+                    continue;
+                const auto* row = rows + static_cast<std::size_t>(k) * stride;
+                for (int j = j0; j < j1; ++j)
+                    sums[static_cast<std::size_t>(j)] += c * row[j];
+            }
+            for (int j = j0; j < j1; ++j)
+            {
+                const auto sum = static_cast<std::uint32_t>(sums[static_cast<std::size_t>(j)] % p);
+                target[j] = target[j] >= sum ? target[j] - sum : target[j] + (p - sum);
+            }
+        }
+    }
+
+    // Natural numbers of any size, for the values put together from their
+    // residues: 32-bit limbs, least significant first, no leading zeros
+    using Natural = std::vector<std::uint32_t>;
+
+    // x = x * m + a
+    void multiplyAdd(Natural& x, std::uint32_t m, std::uint32_t a)
+    {
+        auto carry = std::uint64_t(a);
+        for (auto& limb : x)
+        {
+            carry += std::uint64_t(limb) * m;
+            limb = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        if (carry != 0)
+            x.push_back(static_cast<std::uint32_t>(carry));
+        while (!x.empty() && x.back() == 0)
+            x.pop_back();
+    }
+
+    // x = x / m, returning x % m
+    std::uint32_t divide(Natural& x, std::uint32_t m)
+    {
+        auto rest = std::uint64_t(0);
+        for (auto i = x.size(); i-- > 0;)
+        {
+            rest = rest << 32 | x[i];
+            x[i] = static_cast<std::uint32_t>(rest / m);
+            rest %= m;
+        }
+        while (!x.empty() && x.back() == 0)
+            x.pop_back();
+        return static_cast<std::uint32_t>(rest);
+    }
+
+    std::uint32_t remainder(const Natural& x, std::uint32_t m)
+    {
+        auto rest = std::uint64_t(0);
+        for (auto i = x.size(); i-- > 0;)
+            rest = (rest << 32 | x[i]) % m;
+        return static_cast<std::uint32_t>(rest);
+    }
+
+    int compare(const Natural& x, const Natural& y)
+    {
+        if (x.size() != y.size())
+            return x.size() < y.size() ? -1 : 1;
+        for (auto i = x.size(); i-- > 0;)
+        {
+            if (x[i] != y[i])
+                return x[i] < y[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+    void add(Natural& x, const Natural& y)
+    {
+        x.resize(std::max(x.size(), y.size()) + 1, 0);
+        auto carry = std::uint64_t(0);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            carry += std::uint64_t(x[i]) + (i < y.size() ? y[i] : 0);
+            x[i] = static_cast<std::uint32_t>(carry);
+            carry >>= 32;
+        }
+        while (!x.empty() && x.back() == 0)
+            x.pop_back();
+    }
+
+    // x = x - y, for x >= y
+    void subtract(Natural& x, const Natural& y)
+    {
+        auto borrow = std::int64_t(0);
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            borrow += std::int64_t(x[i]) - (i < y.size() ? y[i] : 0);
+            x[i] = static_cast<std::uint32_t>(borrow);
+            borrow = borrow < 0 ? -1 : 0;
+        }
+        while (!x.empty() && x.back() == 0)
+            x.pop_back();
+    }
+
+    void shiftRight(Natural& x)
+    {
+        for (std::size_t i = 0; i < x.size(); ++i)
+            x[i] = x[i] >> 1 | (i + 1 < x.size() ? x[i + 1] << 31 : 0);
+        while (!x.empty() && x.back() == 0)
+            x.pop_back();
+    }
+
+    bool even(const Natural& x)
+    {
+        return x.empty() || x.front() % 2 == 0;
+    }
+
+    // binary gcd, of non-zero x and y
+    Natural gcd(Natural x, Natural y)
+    {
+        int shift = 0;
+        for (; even(x) && even(y); ++shift)
+        {
+            shiftRight(x);
+            shiftRight(y);
+        }
+        while (!x.empty())
+        {
+            while (even(x))
+                shiftRight(x);
+            while (even(y))
+                shiftRight(y);
+            if (compare(x, y) < 0)
+                std::swap(x, y);
+            subtract(x, y);
+        }
+        for (; shift > 0; --shift)
+            multiplyAdd(y, 2, 0);
+        return y;
+    }
+
+    // x / y, for y dividing x: bit by bit, from the top
+    Natural quotient(const Natural& x, const Natural& y)
+    {
+        auto result = Natural(x.size(), 0);
+        auto rest = Natural();
+        for (auto bit = x.size() * 32; bit-- > 0;)
+        {
+            multiplyAdd(rest, 2, x[bit / 32] >> bit % 32 & 1);
+            if (compare(rest, y) >= 0)
+            {
+                subtract(rest, y);
+                result[bit / 32] |= std::uint32_t(1) << bit % 32;
+            }
+        }
+        while (!result.empty() && result.back() == 0)
+            result.pop_back();
+        return result;
+    }
+
+    std::string text(Natural x)
+    {
+        if (x.empty())
+            return "0";
+        auto groups = std::vector<std::uint32_t>();
+        while (!x.empty())
+            groups.push_back(divide(x, 1000000000));
+        auto result = std::to_string(groups.back());
+        for (auto i = groups.size() - 1; i-- > 0;)
+        {
+            const auto group = std::to_string(groups[i]);
+            result += std::string(9 - group.size(), '0') + group;
+        }
+        return result;
+    }
+
+    // An integer put together from its residues modulo distinct primes, in
+    // (-M / 2, M / 2] for M the product of the primes
+    class Reconstruction
+    {
+    public:
+        void add(std::uint32_t r, std::uint32_t p)
+        {
+            // x + M t is r modulo p and still x modulo M
+            const auto t = multiply(r + (p - remainder(m_value, p)), inverse(remainder(m_modulus, p), p), p);
+            auto step = m_modulus;
+            multiplyAdd(step, t, 0);
+            ::add(m_value, step);
+            multiplyAdd(m_modulus, p, 0);
+        }
+
+        // |value| and whether it is negative
+        std::pair<Natural, bool> value() const
+        {
+            auto twice = m_value;
+            multiplyAdd(twice, 2, 0);
+            if (compare(twice, m_modulus) <= 0)
+                return { m_value, false };
+            auto magnitude = m_modulus;
+            subtract(magnitude, m_value);
+            return { magnitude, true };
+        }
+
+    private:
+        Natural m_value;
+        Natural m_modulus{ 1 };
+    };
+
+    // the value as a matrix element, if it is one in the window
+    std::optional<std::int64_t> element(const std::pair<Natural, bool>& value)
+    {
+        const auto& [magnitude, negative] = value;
+        if (magnitude.size() > 1)
+            return std::nullopt;
+        const auto result = magnitude.empty() ? std::int64_t(0) : std::int64_t(magnitude.front());
+        if (!isInRange(result))
+            return std::nullopt;
+        return negative ? -result : result;
+    }
+
+    [[noreturn]] void invalid(const std::pair<Natural, bool>& numerator, const std::pair<Natural, bool>& denominator)
+    {
+        auto value = (numerator.second != denominator.second ? "-" : "") + text(numerator.first);
+        if (denominator.first != Natural{ 1 })
+            value += "/" + text(denominator.first);
+        throw FileException("the value: " + value + " ,is invalid value");
+    }
+
+    // log2 of the Euclidean norm of n values, step apart
+    double normBits(const std::int64_t* values, int n, std::size_t step)
+    {
+        auto sum = 0.0;
+        for (int k = 0; k < n; ++k)
+        {
+            const auto value = static_cast<double>(values[static_cast<std::size_t>(k) * step]);
+            sum += value * value;
+        }
+        return 0.5 * std::log2(sum);
+    }
+}
+
+
+ModularLu::ModularLu(std::vector<std::int64_t> values, int size, int block)
+    : m_size(size), m_block(block), m_values(std::move(values))
+{
+    for (int i = 0; i < size; ++i)
+    {
+        m_rowBits += normBits(m_values.data() + static_cast<std::size_t>(i) * static_cast<std::size_t>(size), size, 1);
+        m_columnBits += normBits(m_values.data() + i, size, static_cast<std::size_t>(size));
+    }
+    // a zero row or column: det(A) = 0 (the bound is -inf)
+    if (size > 0 && !(std::min(m_rowBits, m_columnBits) >= 0))
+        return;
+
+    // A is singular modulo every prime only if det(A) = 0, which is certain
+    // once the primes multiply to more than the bound
+    auto bits = 0.0;
+    while (bits <= std::min(m_rowBits, m_columnBits) + 1)
+    {
+        auto factors = factor(prime(m_primes++));
+        bits += std::log2(factors.prime);
+        if (factors.det != 0)
+        {
+            m_factors = std::move(factors);
+            return;
+        }
+    }
+}
+
+
+ModularLu::Factors ModularLu::factor(std::uint32_t prime) const
+{
+    const auto n = static_cast<std::size_t>(m_size);
+    auto factors = Factors{ prime, std::vector<std::uint32_t>(n * n), std::vector<int>(n), 0 };
+    auto& lu = factors.lu;
+    std::transform(m_values.begin(), m_values.end(), lu.begin(), [&](std::int64_t value) { return residue(value, prime); });
+    const auto row = [&](int i) { return lu.data() + static_cast<std::size_t>(i) * n; };
+    auto sums = std::vector<std::uint64_t>(n);
+    auto negative = false;
+
+    for (int begin = 0; begin < m_size; begin += m_block)
+    {
+        const int end = std::min(begin + m_block, m_size);
+
+        // the panel: any non-zero residue is an exact pivot
+        for (int k = begin; k < end; ++k)
+        {
+            int pivot = k;
+            while (pivot < m_size && row(pivot)[k] == 0)
+                ++pivot;
+            if (pivot == m_size)
+                return factors;
+            factors.pivots[static_cast<std::size_t>(k)] = pivot;
+            if (pivot != k)
+            {
+                std::swap_ranges(row(k), row(k) + n, row(pivot));
+                negative = !negative;
+            }
+            const auto scale = inverse(row(k)[k], prime);
+            for (int i = k + 1; i < m_size; ++i)
+            {
+                if (row(i)[k] == 0)
+                    continue;
+                row(i)[k] = multiply(row(i)[k], scale, prime);
+                subtractProducts(row(i), row(i), lu.data(), n, k, k + 1, k + 1, end, prime, sums);
+            }
+        }
+
+        // U12 = L11^-1 A12 for the rows of the block, A22 -= L21 U12 below
+        for (int i = begin + 1; i < m_size; ++i)
+            subtractProducts(row(i), row(i), lu.data(), n, begin, std::min(i, end), end, m_size, prime, sums);
+    }
+
+    factors.det = negative ? prime - 1 : 1;
+    for (int k = 0; k < m_size; ++k)
+        factors.det = multiply(factors.det, row(k)[k], prime);
+    return factors;
+}
+
+
+std::vector<std::uint32_t> ModularLu::solve(const Factors& factors, const std::vector<std::int64_t>& rhs, int columns) const
+{
+    const auto p = factors.prime;
+    const auto m = static_cast<std::size_t>(columns);
+    auto x = std::vector<std::uint32_t>(rhs.size());
+    std::transform(rhs.begin(), rhs.end(), x.begin(), [&](std::int64_t value) { return residue(value, p); });
+    const auto row = [&](int i) { return x.data() + static_cast<std::size_t>(i) * m; };
+    const auto lu = [&](int i) { return factors.lu.data() + static_cast<std::size_t>(i) * static_cast<std::size_t>(m_size); };
+    auto sums = std::vector<std::uint64_t>(m);
+
+    for (int k = 0; k < m_size; ++k)
+    {
+        const int pivot = factors.pivots[static_cast<std::size_t>(k)];
+        if (pivot != k)
+            std::swap_ranges(row(k), row(k) + m, row(pivot));
+    }
+    for (int i = 1; i < m_size; ++i)
+        subtractProducts(row(i), lu(i), x.data(), m, 0, i, 0, columns, p, sums);
+    for (int i = m_size - 1; i >= 0; --i)
+    {
+        subtractProducts(row(i), lu(i), x.data(), m, i + 1, m_size, 0, columns, p, sums);
+        const auto scale = inverse(lu(i)[i], p);
+        for (std::size_t j = 0; j < m; ++j)
+            row(i)[j] = multiply(row(i)[j], scale, p);
+    }
+    return x;
+}
+
+
+std::int64_t ModularLu::determinant() const
+{
+    if (singular())
+        return 0;
+
+    // the primes before the one A was factored at are factors of det(A)
+    auto det = Reconstruction();
+    auto bits = 0.0;
+    for (std::size_t k = 0; k + 1 < m_primes; ++k)
+    {
+        det.add(0, prime(k));
+        bits += std::log2(prime(k));
+    }
+    det.add(m_factors->det, m_factors->prime);
+    bits += std::log2(m_factors->prime);
+    for (auto k = m_primes; bits <= std::min(m_rowBits, m_columnBits) + 1; ++k)
+    {
+        const auto p = prime(k);
+        det.add(factor(p).det, p);
+        bits += std::log2(p);
+    }
+
+    const auto value = det.value();
+    if (const auto result = element(value))
+        return *result;
+    invalid(value, { Natural{ 1 }, false });
+}
+
+
+std::vector<std::int64_t> ModularLu::solve(const std::vector<std::int64_t>& rhs) const
+{
+    if (singular())
+        throw FileException("the matrix is singular");
+
+    // the solution modulo one prime, in (-p / 2, p / 2]: the solution itself
+    // if A X == B and X is in the window
+    const auto n = static_cast<std::size_t>(m_size);
+    const auto p = m_factors->prime;
+    const auto residues = solve(*m_factors, rhs, m_size);
+    auto x = std::vector<std::int64_t>(residues.size());
+    std::transform(residues.begin(), residues.end(), x.begin(),
+        [&](std::uint32_t r) { return r > p / 2 ? std::int64_t(r) - p : std::int64_t(r); });
+    auto exact = std::all_of(x.begin(), x.end(), [](std::int64_t value) { return isInRange(value); });
+    auto product = std::vector<std::int64_t>(n);
+    for (std::size_t i = 0; i < n && exact; ++i)
+    {
+        std::fill(product.begin(), product.end(), std::int64_t(0));
+        for (std::size_t k = 0; k < n; ++k)
+        {
+            const auto a = m_values[i * n + k];
+            for (std::size_t j = 0; a != 0 && j < n; ++j)
+                product[j] += a * x[k * n + j];
+        }
+        exact = std::equal(product.begin(), product.end(), rhs.begin() + static_cast<std::ptrdiff_t>(i * n));
+    }
+    if (exact)
+        return x;
+
+    // Otherwise x = N / det(A) for integers N of at most the Hadamard bound
+    // of A with a column replaced by one of rhs. With primes that multiply
+    // to more than 2 |N - x det(A)|, x is exact where its residues match all
+    // of them; the first value where one does not is reconstructed
+    auto rhsBits = 0.0;
+    for (int j = 0; j < m_size; ++j)
+        rhsBits = std::max(rhsBits, normBits(rhs.data() + j, m_size, n));
+    const auto bound = std::max(m_columnBits + rhsBits, std::min(m_rowBits, m_columnBits) + std::log2(MAX_ALLOWED_VALUE)) + 2;
+    auto primes = std::vector<std::uint32_t>{ p };
+    auto bits = std::log2(p);
+    auto wrong = std::vector<char>(x.size());
+    std::transform(x.begin(), x.end(), wrong.begin(), [](std::int64_t value) { return !isInRange(value); });
+    for (auto k = m_primes; bits <= bound; ++k)
+    {
+        // a prime at which A is singular has no solution to compare
+        const auto factors = factor(prime(k));
+        if (factors.det == 0)
+            continue;
+        const auto other = solve(factors, rhs, m_size);
+        for (std::size_t e = 0; e < x.size(); ++e)
+            wrong[e] |= other[e] != residue(x[e], factors.prime);
+        primes.push_back(factors.prime);
+        bits += std::log2(factors.prime);
+    }
+    const auto first = static_cast<std::size_t>(std::find(wrong.begin(), wrong.end(), char(1)) - wrong.begin());
+    if (first == x.size())
+        return x;
+
+    // N and det(A) of that value, from its column of rhs
+    auto column = std::vector<std::int64_t>(n);
+    for (std::size_t i = 0; i < n; ++i)
+        column[i] = rhs[i * n + first % n];
+    auto numerator = Reconstruction();
+    auto det = Reconstruction();
+    for (const auto q : primes)
+    {
+        const auto factors = q == p ? *m_factors : factor(q);
+        numerator.add(multiply(solve(factors, column, 1)[first / n], factors.det, q), q);
+        det.add(factors.det, q);
+    }
+    auto [a, aNegative] = numerator.value();
+    auto [b, bNegative] = det.value();
+    const auto divisor = gcd(a, b);
+    invalid({ quotient(a, divisor), aNegative }, { quotient(b, divisor), bNegative });
+}
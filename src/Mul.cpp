@@ -0,0 +1,29 @@
+#include "Mul.h"
+
+#include <iostream>
+
+
+Operation::T Mul::compute(Input input) const
+{
+    const auto a = first()->compute(input);
+    const auto b = second()->compute(secondInput(input));
+
+    return a * b;
+}
+
+
+Program::Value Mul::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    const auto fork = builder.fork();
+    const auto a = builder.plain(builder.compile(*first(), input.first(static_cast<std::size_t>(firstCount()))));
+    builder.split(fork);
+    const auto b = builder.plain(builder.compile(*second(), input.subspan(static_cast<std::size_t>(firstCount()))));
+    builder.join(fork);
+    return builder.emit(Program::OpCode::Mul, a, b);
+}
+
+
+void Mul::printSymbol(std::ostream& ostr) const
+{
+    ostr << '*';
+}
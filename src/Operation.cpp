@@ -1,13 +1,40 @@
 #include "Operation.h"
 
 #include <iostream>
+#include <atomic>
 
 
-void Operation::print(std::ostream& ostr, const std::vector<T>& input) const
+std::optional<Operation::Term> Operation::term(Input input) const
 {
-	print(ostr);
-	for (int i = 0; i < inputCount(); ++i)
+	(void)input;
+	return std::nullopt;
+}
+
+
+std::uint64_t Operation::nextId()
+{
+	static auto next = std::atomic<std::uint64_t>(1);
+	return next++;
+}
+
+
+Operation::T Operation::consume(T input) const
+{
+	return compute(Input(std::span<const T>(&input, 1)));
+}
+
+
+Operation::Structure Operation::structure() const
+{
+	return Structure{ typeid(*this), std::nullopt, {} };
+}
+
+
+const Program& Operation::program() const
+{
+	if (!m_program)
 	{
-		ostr << "(\n" << input[i] << ")";
+		m_program = std::make_shared<const Program>(Program::compile(*this));
 	}
+	return *m_program;
 }
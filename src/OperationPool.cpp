@@ -0,0 +1,124 @@
+#include "OperationPool.h"
+#include "InputException.h"
+
+#include <algorithm>
+#include <string>
+
+
+OperationPool::OperationPool(bool intern)
+    : m_intern(intern)
+{
+}
+
+
+const Operation& OperationPool::operator[](OperationHandle handle) const
+{
+    return *m_slots[slotOf(handle)].operation;
+}
+
+
+bool OperationPool::contains(OperationHandle handle) const
+{
+    return handle.index < m_slots.size() && m_slots[handle.index].operation
+        && m_slots[handle.index].generation == handle.generation;
+}
+
+
+std::size_t OperationPool::references(OperationHandle handle) const
+{
+    return m_slots[slotOf(handle)].references;
+}
+
+
+void OperationPool::retain(OperationHandle handle)
+{
+    ++m_slots[slotOf(handle)].references;
+}
+
+
+void OperationPool::release(OperationHandle handle)
+{
+    auto pending = std::vector<std::uint32_t>{ slotOf(handle) };
+    while (!pending.empty())
+    {
+        const auto index = pending.back();
+        pending.pop_back();
+        auto& slot = m_slots[index];
+        if (--slot.references != 0)
+            continue;
+
+        for (const auto child : slot.children)
+        {
+            if (child != NoSlot)
+                pending.push_back(child);
+        }
+        if (m_intern)
+            m_table.erase(slot.operation->structure());
+        slot.operation.reset();
+        slot.children[0] = slot.children[1] = NoSlot;
+        ++slot.generation;
+        slot.nextFree = m_free;
+        m_free = index;
+        --m_size;
+    }
+}
+
+
+OperationHandle OperationPool::insert(std::unique_ptr<Operation> operation, std::initializer_list<OperationHandle> children)
+{
+    std::uint32_t childSlots[2] = { NoSlot, NoSlot };
+    auto depth = std::uint32_t(1);
+    auto k = std::size_t(0);
+    for (const auto child : children)
+    {
+        childSlots[k] = slotOf(child);
+        depth = std::max(depth, m_slots[childSlots[k++]].depth + 1);
+    }
+    if (depth > OPERATION_MAX_DEPTH)
+        throw InputException("The operation would be " + std::to_string(depth) + " levels deep, the maximum is " + std::to_string(OPERATION_MAX_DEPTH));
+
+    auto structure = std::optional<Operation::Structure>();
+    if (m_intern)
+    {
+        structure = operation->structure();
+        if (const auto existing = m_table.find(*structure))
+        {
+            auto& slot = m_slots[*existing];
+            ++slot.references;
+            return OperationHandle{ *existing, slot.generation };
+        }
+    }
+
+    auto index = m_free;
+    if (index != NoSlot)
+        m_free = m_slots[index].nextFree;
+    else
+    {
+        index = static_cast<std::uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    auto& slot = m_slots[index];
+    for (k = 0; k < 2; ++k)
+    {
+        slot.children[k] = childSlots[k];
+        if (childSlots[k] != NoSlot)
+            ++m_slots[childSlots[k]].references;
+    }
+    slot.operation = std::move(operation);
+    slot.references = 1;
+    slot.depth = depth;
+    slot.nextFree = NoSlot;
+    ++m_size;
+    if (structure)
+        m_table.insert(std::move(*structure), index);
+    return OperationHandle{ index, slot.generation };
+}
+
+
+std::uint32_t OperationPool::slotOf(OperationHandle handle) const
+{
+    if (!contains(handle))
+        throw InputException("the operation was deleted");
+    return handle.index;
+}
@@ -0,0 +1,38 @@
+#include "OperationTable.h"
+
+#include <functional>
+
+
+std::size_t OperationTable::StructureHash::operator()(const Operation::Structure& structure) const
+{
+    auto hash = structure.kind.hash_code();
+    const auto mix = [&](std::size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    };
+    if (structure.parameter)
+        mix(std::hash<int>()(*structure.parameter) + 1);
+    for (const auto child : structure.children)
+        mix(std::hash<std::uint64_t>()(child));
+    return hash;
+}
+
+
+std::optional<std::uint32_t> OperationTable::find(const Operation::Structure& structure) const
+{
+    const auto it = m_entries.find(structure);
+    if (it == m_entries.end())
+        return std::nullopt;
+    return it->second;
+}
+
+
+void OperationTable::insert(Operation::Structure structure, std::uint32_t slot)
+{
+    m_entries.insert_or_assign(std::move(structure), slot);
+}
+
+
+void OperationTable::erase(const Operation::Structure& structure)
+{
+    m_entries.erase(structure);
+}
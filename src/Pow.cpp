@@ -0,0 +1,43 @@
+#include "Pow.h"
+#include "MatrixPower.h"
+#include "InputException.h"
+
+#include <iostream>
+#include <string>
+
+
+Pow::Pow(const Operation& base, int exponent)
+    : m_base(&base), m_baseCount(base.inputCount()), m_exponent(exponent)
+{
+    if (exponent < 1)
+        throw InputException("The exponent must be at least 1, got " + std::to_string(exponent));
+}
+
+
+Operation::T Pow::compute(Input input) const
+{
+    return power(m_base->compute(input), m_exponent);
+}
+
+
+Operation::Structure Pow::structure() const
+{
+    return Structure{ typeid(*this), m_exponent, { m_base->id() } };
+}
+
+
+Program::Value Pow::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    return builder.power(builder.plain(builder.compile(*m_base, input)), m_exponent);
+}
+
+
+void Pow::print(std::ostream& ostr, bool first_print) const
+{
+    if (!first_print)
+        ostr << '(';
+    m_base->print(ostr);
+    ostr << " ^ " << m_exponent;
+    if (!first_print)
+        ostr << ')';
+}
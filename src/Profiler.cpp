@@ -0,0 +1,119 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+
+namespace
+{
+    struct Registry
+    {
+        std::mutex mutex;
+        std::unordered_map<std::uint64_t, std::string> names;
+        std::unordered_map<std::uint64_t, OperationStats> stats;
+    };
+
+    Registry& registry()
+    {
+        static auto instance = Registry();
+        return instance;
+    }
+
+    std::string quoted(const std::string& text)
+    {
+        auto result = std::string("\"");
+        for (const auto c : text)
+        {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            if (c == '\n')
+                result += "\\n";
+            else
+                result += c;
+        }
+        return result + '"';
+    }
+}
+
+
+void Profiler::describe(std::uint64_t operation, std::string name)
+{
+    auto& r = registry();
+    const auto lock = std::lock_guard(r.mutex);
+    r.names[operation] = std::move(name);
+}
+
+
+void Profiler::record(std::uint64_t operation, std::uint64_t ns, std::uint64_t bytes, std::uint64_t elements)
+{
+    auto& r = registry();
+    const auto lock = std::lock_guard(r.mutex);
+    auto& stats = r.stats[operation];
+    stats.operation = operation;
+    ++stats.calls;
+    stats.totalNs += ns;
+    stats.maxNs = std::max(stats.maxNs, ns);
+    stats.bytes += bytes;
+    stats.elements += elements;
+}
+
+
+std::vector<OperationStats> Profiler::snapshot()
+{
+    auto& r = registry();
+    auto result = std::vector<OperationStats>();
+    {
+        const auto lock = std::lock_guard(r.mutex);
+        for (const auto& [operation, stats] : r.stats)
+        {
+            result.push_back(stats);
+            if (const auto it = r.names.find(operation); it != r.names.end())
+                result.back().name = it->second;
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const OperationStats& a, const OperationStats& b) {
+        return a.totalNs != b.totalNs ? a.totalNs > b.totalNs : a.operation < b.operation;
+    });
+    return result;
+}
+
+
+void Profiler::reset()
+{
+    auto& r = registry();
+    const auto lock = std::lock_guard(r.mutex);
+    r.stats.clear();
+}
+
+
+void Profiler::writeTable(std::ostream& ostr, const std::vector<OperationStats>& stats)
+{
+    ostr << std::right << std::setw(8) << "calls" << std::setw(14) << "total us" << std::setw(12) << "mean us"
+        << std::setw(12) << "max us" << std::setw(14) << "bytes" << std::setw(16) << "elements" << "  operation\n";
+    const auto micro = [](double ns) { return ns / 1000.0; };
+    for (const auto& s : stats)
+    {
+        ostr << std::setw(8) << s.calls << std::fixed << std::setprecision(1)
+            << std::setw(14) << micro(static_cast<double>(s.totalNs))
+            << std::setw(12) << micro(static_cast<double>(s.totalNs) / static_cast<double>(s.calls))
+            << std::setw(12) << micro(static_cast<double>(s.maxNs))
+            << std::setw(14) << s.bytes << std::setw(16) << s.elements << "  " << s.name << '\n';
+    }
+}
+
+
+void Profiler::writeJson(std::ostream& ostr, const std::vector<OperationStats>& stats)
+{
+    ostr << "[";
+    for (std::size_t i = 0; i < stats.size(); ++i)
+    {
+        const auto& s = stats[i];
+        ostr << (i == 0 ? "\n" : ",\n") << "  {\"operation\": " << s.operation << ", \"name\": " << quoted(s.name)
+            << ", \"calls\": " << s.calls << ", \"total_ns\": " << s.totalNs << ", \"max_ns\": " << s.maxNs
+            << ", \"bytes\": " << s.bytes << ", \"elements\": " << s.elements << "}";
+    }
+    ostr << "\n]\n";
+}
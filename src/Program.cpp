@@ -0,0 +1,936 @@
+#include "Program.h"
+#include "Operation.h"
+#include "EvalCache.h"
+#include "ThreadPool.h"
+#include "FixedSquareMatrix.h"
+#include "SparseMatrix.h"
+#include "MatrixPower.h"
+#include "LuFactorization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#if OOP2_PROFILE
+#include <sstream>
+#endif
+
+
+namespace
+{
+    // the per-register arrays of a run come from the MatrixPool too, so a
+    // run in steady state does not call malloc at all
+    template <typename V>
+    using PooledVector = std::vector<V, PoolAllocator<V>>;
+
+    std::atomic<bool> sparse{ true };
+}
+
+
+Program::Builder::Builder(int inputCount)
+    : m_inputCount(inputCount), m_registerCount(inputCount)
+{
+}
+
+
+Program::Value Program::Builder::compile(const Operation& operation, std::span<const Value> input)
+{
+    const auto root = m_depth == 0;
+    ++m_depth;
+
+#if OOP2_PROFILE
+    // the instructions emitted from here on belong to operation and its parents
+    const auto parent = m_owner;
+    struct Restore
+    {
+        std::size_t& owner;
+        std::size_t parent;
+        ~Restore() { owner = parent; }
+    } restore{ m_owner, parent };
+    if (!m_counting)
+    {
+        auto owners = m_owners[parent];
+        owners.push_back(operation.id());
+        m_owners.push_back(std::move(owners));
+        m_owner = m_owners.size() - 1;
+
+        auto name = std::ostringstream();
+        operation.print(name, true);
+        Profiler::describe(operation.id(), name.str());
+    }
+#endif
+
+    if (m_counting)
+    {
+        ++m_visits[&operation];
+        const auto begin = position();
+        const auto result = operation.compile(*this, input);
+        if (position() != begin)
+            m_emits.insert(&operation);
+        --m_depth;
+        return result;
+    }
+
+    // an operation without instructions is only a view, there is nothing to save
+    const auto shared = m_visits[&operation] > 1;
+    if (!m_emits.contains(&operation) || !(shared || root))
+    {
+        const auto result = operation.compile(*this, input);
+        --m_depth;
+        return result;
+    }
+
+    const auto dst = m_registerCount++;
+    auto lookup = make(OpCode::MemoLookup, dst, Value(), Value());
+    lookup.operation = operation.id();
+    lookup.inputsBegin = m_memoInputs.size();
+    for (const auto& value : input)
+    {
+        m_memoInputs.push_back({ value });
+    }
+    lookup.inputsEnd = m_memoInputs.size();
+    lookup.crossEvalOnly = !shared;
+    m_code.push_back(lookup);
+
+    // the cache holds plain matrices; a scaled view is checked here, as it
+    // would be by the consumer right after this block
+    const auto result = plain(operation.compile(*this, input));
+    m_code.push_back(make(OpCode::MemoStore, dst, result, Value()));
+    --m_depth;
+    return Value{ dst };
+}
+
+
+Program::Instruction Program::Builder::make(OpCode code, int dst, const Value& a, const Value& b) const
+{
+    auto instruction = Instruction{ code, dst, { a }, { b } };
+#if OOP2_PROFILE
+    instruction.owners = m_owner;
+#endif
+    return instruction;
+}
+
+
+Program::Value Program::Builder::emit(OpCode code, const Value& a, const Value& b)
+{
+    m_code.push_back(make(code, m_registerCount, a, b));
+    return Value{ m_registerCount++ };
+}
+
+
+Program::Value Program::Builder::emit(OpCode code, const Value& a)
+{
+    return emit(code, a, Value());
+}
+
+
+Program::Value Program::Builder::power(const Value& a, int exponent)
+{
+    auto instruction = make(OpCode::Pow, m_registerCount, a, Value());
+    instruction.exponent = exponent;
+    m_code.push_back(instruction);
+    return Value{ m_registerCount++ };
+}
+
+
+Program::Value Program::Builder::plain(const Value& a)
+{
+    return a.isView() ? emit(OpCode::Materialize, a) : a;
+}
+
+
+Program::Value Program::Builder::plainAt(std::size_t position, const Value& a)
+{
+    if (!a.isView())
+        return a;
+
+    // registers are written once, so moving the copy earlier cannot change what it reads
+    m_code.insert(m_code.begin() + static_cast<std::ptrdiff_t>(position), make(OpCode::Materialize, m_registerCount, a, Value()));
+    return Value{ m_registerCount++ };
+}
+
+
+int Program::Builder::fork()
+{
+    m_code.push_back({ OpCode::Fork, m_forkCount, {}, {} });
+    return m_forkCount++;
+}
+
+
+std::size_t Program::Builder::split(int fork)
+{
+    m_code.push_back({ OpCode::Split, fork, {}, {} });
+    return m_code.size() - 1;
+}
+
+
+void Program::Builder::join(int fork)
+{
+    const auto marker = [&](OpCode code) {
+        const auto it = std::find_if(m_code.rbegin(), m_code.rend(), [&](const Instruction& instruction) {
+            return instruction.code == code && instruction.dst == fork;
+        });
+        return static_cast<std::size_t>(m_code.rend() - it) - 1;
+    };
+    const auto begin = marker(OpCode::Fork);
+    const auto split = marker(OpCode::Split);
+
+    // with an empty branch there is nothing to run in parallel
+    if (split == begin + 1 || split + 1 == m_code.size())
+    {
+        m_code.erase(m_code.begin() + static_cast<std::ptrdiff_t>(split));
+        m_code.erase(m_code.begin() + static_cast<std::ptrdiff_t>(begin));
+        return;
+    }
+    m_code.push_back({ OpCode::Join, fork, {}, {} });
+}
+
+
+Program Program::Builder::finish(const Value& result)
+{
+    // the result must be a temporary so that run() can move it out
+    const auto root = (result.isView() || result.reg < m_inputCount) ? emit(OpCode::Materialize, result) : result;
+
+    const auto readsB = [](OpCode code) {
+        return code == OpCode::Add || code == OpCode::Sub || code == OpCode::Mul || code == OpCode::Solve;
+    };
+
+    auto lastUse = std::vector<std::size_t>(static_cast<std::size_t>(m_registerCount), m_code.size());
+    auto store = std::unordered_map<int, std::size_t>();
+    auto split = std::unordered_map<int, std::size_t>();
+    auto join = std::unordered_map<int, std::size_t>();
+    for (std::size_t i = 0; i < m_code.size(); ++i)
+    {
+        const auto& instruction = m_code[i];
+        if (instruction.code == OpCode::Fork)
+            continue;
+        if (instruction.code == OpCode::Split || instruction.code == OpCode::Join)
+        {
+            (instruction.code == OpCode::Split ? split : join)[instruction.dst] = i;
+            continue;
+        }
+        if (instruction.code == OpCode::MemoLookup)
+        {
+            for (auto k = instruction.inputsBegin; k < instruction.inputsEnd; ++k)
+                lastUse[static_cast<std::size_t>(m_memoInputs[k].value.reg)] = i;
+            continue;
+        }
+        if (instruction.code == OpCode::MemoStore)
+            store[instruction.dst] = i;
+        lastUse[static_cast<std::size_t>(instruction.a.value.reg)] = i;
+        if (readsB(instruction.code))
+            lastUse[static_cast<std::size_t>(instruction.b.value.reg)] = i;
+    }
+
+    const auto isTemporary = [&](const Operand& operand) {
+        return operand.value.reg >= m_inputCount && operand.value.reg != root.reg;
+    };
+    for (std::size_t i = 0; i < m_code.size(); ++i)
+    {
+        auto& instruction = m_code[i];
+        if (instruction.code == OpCode::Split || instruction.code == OpCode::Join)
+            continue;
+        if (instruction.code == OpCode::Fork)
+        {
+            instruction.split = split.at(instruction.dst);
+            instruction.join = join.at(instruction.dst);
+            for (auto k = i + 1; k < instruction.join; ++k)
+            {
+                const auto branch = k < instruction.split ? 0 : 1;
+                const auto code = m_code[k].code;
+                if (code == OpCode::Mul || code == OpCode::Det)
+                    ++instruction.products[branch];
+                else if (code == OpCode::Inverse || code == OpCode::Solve)
+                    instruction.products[branch] += 2;
+                else if (code == OpCode::Pow)
+                    instruction.products[branch] += static_cast<std::size_t>(powerProducts(m_code[k].exponent));
+                else if (code == OpCode::Add || code == OpCode::Sub || code == OpCode::Materialize)
+                    ++instruction.elementwise[branch];
+            }
+            continue;
+        }
+        if (instruction.code == OpCode::MemoLookup)
+        {
+            // on a hit the block is skipped: release the inputs whose last use is inside it
+            instruction.skip = store.at(instruction.dst) + 1;
+            for (auto k = instruction.inputsBegin; k < instruction.inputsEnd; ++k)
+            {
+                auto& input = m_memoInputs[k];
+                input.lastUse = isTemporary(input) && lastUse[static_cast<std::size_t>(input.value.reg)] < instruction.skip;
+            }
+            continue;
+        }
+        const auto isLast = [&](const Operand& operand) {
+            return isTemporary(operand) && lastUse[static_cast<std::size_t>(operand.value.reg)] == i;
+        };
+        instruction.a.lastUse = isLast(instruction.a);
+        instruction.b.lastUse = readsB(instruction.code) && isLast(instruction.b);
+    }
+
+    auto program = Program(m_inputCount, m_registerCount, root.reg, std::move(m_code), std::move(m_memoInputs));
+#if OOP2_PROFILE
+    program.m_owners = std::move(m_owners);
+#endif
+    return program;
+}
+
+
+Program::Program(int inputCount, int registerCount, int result, std::vector<Instruction> code, std::vector<Operand> memoInputs)
+    : m_inputCount(inputCount), m_registerCount(registerCount), m_result(result), m_code(std::move(code)), m_memoInputs(std::move(memoInputs))
+{
+    m_sharedBlocks = std::ranges::any_of(m_code, [](const Instruction& instruction) {
+        return instruction.code == OpCode::MemoLookup && !instruction.crossEvalOnly;
+    });
+    m_products = std::ranges::any_of(m_code, [](const Instruction& instruction) { return instruction.code == OpCode::Mul; });
+    m_factors = std::ranges::any_of(m_code, [](const Instruction& instruction) {
+        return instruction.code == OpCode::Det || instruction.code == OpCode::Inverse || instruction.code == OpCode::Solve;
+    });
+}
+
+
+void Program::setSparseEnabled(bool enabled)
+{
+    sparse.store(enabled, std::memory_order_relaxed);
+}
+
+
+bool Program::sparseEnabled()
+{
+    return sparse.load(std::memory_order_relaxed);
+}
+
+
+Program Program::compile(const Operation& operation)
+{
+    auto inputs = std::vector<Value>();
+    for (int i = 0; i < operation.inputCount(); ++i)
+    {
+        inputs.push_back(Value{ i });
+    }
+
+    // the first pass finds the operations that occur more than once
+    auto counter = Builder(operation.inputCount());
+    counter.compile(operation, inputs);
+
+    auto builder = Builder(operation.inputCount());
+    builder.m_counting = false;
+    builder.m_visits = std::move(counter.m_visits);
+    builder.m_emits = std::move(counter.m_emits);
+    const auto result = builder.compile(operation, inputs);
+    return builder.finish(result);
+}
+
+
+template <typename E>
+Program::Matrix<E> Program::run(std::span<const MatrixView<E>> input, EvalCache* cache, ThreadPool* pool) const
+{
+    if (auto result = runFixedSize(input, cache))
+        return std::move(*result);
+
+    auto matrices = PooledVector<Matrix<E>>();
+    matrices.reserve(input.size());
+    for (const auto& view : input)
+        matrices.emplace_back(view);
+    return run(std::span<const Matrix<E>>(matrices), cache, pool);
+}
+
+
+template <typename E>
+struct Program::State
+{
+    using Dense = Matrix<E>;
+
+    std::span<const Dense> input;
+    EvalCache* cache;
+    ThreadPool* pool;
+    PooledVector<const Dense*> registers;
+    PooledVector<std::optional<Dense>> storage;
+    // results shared with the cache
+    PooledVector<std::shared_ptr<const Dense>> shared;
+    PooledVector<std::optional<EvalCache::Key>> keys;
+    PooledVector<std::optional<EvalCache::Digest>> hashes;
+#if OOP2_PROFILE
+    std::vector<std::int64_t> times;
+#endif
+};
+
+
+template <typename E>
+Program::Matrix<E> Program::run(std::span<const Matrix<E>> input, EvalCache* cache, ThreadPool* pool) const
+{
+    using Dense = Matrix<E>;
+    if (auto result = runFixedSize(input, cache))
+        return std::move(*result);
+    if (auto result = runSparse(input, cache))
+        return std::move(*result);
+
+    const auto count = static_cast<std::size_t>(m_registerCount);
+    auto state = State<E>{ input, cache, pool, PooledVector<const Dense*>(count, nullptr), PooledVector<std::optional<Dense>>(count),
+        PooledVector<std::shared_ptr<const Dense>>(count), PooledVector<std::optional<EvalCache::Key>>(count), PooledVector<std::optional<EvalCache::Digest>>(count) };
+    for (int i = 0; i < m_inputCount; ++i)
+    {
+        state.registers[static_cast<std::size_t>(i)] = &input[static_cast<std::size_t>(i)];
+    }
+
+    // the entries of this eval stay in the cache until it ends, even if it throws
+    struct EndEval
+    {
+        EvalCache* cache;
+        ~EndEval() { if (cache) cache->endEval(); }
+    } endEval{ cache };
+
+#if OOP2_PROFILE
+    state.times.assign(m_code.size(), -1);
+    execute(state, 0, m_code.size());
+    profile(state.times, input.empty() ? 0 : input.front().size(), sizeof(E), false);
+#else
+    execute(state, 0, m_code.size());
+#endif
+
+    auto& result = state.storage[static_cast<std::size_t>(m_result)];
+    return result ? std::move(*result) : *state.registers[static_cast<std::size_t>(m_result)];
+}
+
+
+template <typename E>
+void Program::execute(State<E>& state, std::size_t begin, std::size_t end) const
+{
+    using Dense = Matrix<E>;
+#if OOP2_PROFILE
+    auto& [input, cache, pool, registers, storage, shared, keys, hashes, times] = state;
+#else
+    auto& [input, cache, pool, registers, storage, shared, keys, hashes] = state;
+#endif
+
+    const auto at = [&](int reg) -> const Dense& { return *registers[static_cast<std::size_t>(reg)]; };
+    const auto term = [&](const Operand& operand) {
+        const auto& value = operand.value;
+        return MatrixTerm<E>(at(value.reg), value.transposed, value.scale ? std::optional<E>(static_cast<E>(*value.scale)) : std::nullopt);
+    };
+    const auto release = [&](const Operand& operand) {
+        if (operand.lastUse)
+        {
+            storage[static_cast<std::size_t>(operand.value.reg)].reset();
+            shared[static_cast<std::size_t>(operand.value.reg)].reset();
+        }
+    };
+    const auto hashOf = [&](const Value& value) {
+        auto& hash = hashes[static_cast<std::size_t>(value.reg)];
+        if (!hash)
+            hash = EvalCache::digest(at(value.reg));
+        const auto h = EvalCache::combine(*hash, value.transposed ? 1 : 0);
+        return value.scale ? EvalCache::combine(h, 1ULL << 32 | static_cast<std::uint32_t>(*value.scale)) : h;
+    };
+    // a value computed once per eval (the squares of a power, the
+    // factorization of a matrix): looked up in the cache, or added to it
+    const auto sharedValue = [&](std::uint64_t kind, const EvalCache::Digest& hash, auto compute) {
+        using V = typename decltype(compute())::element_type;
+        if (!cache)
+            return compute();
+        const auto key = EvalCache::Key{ kind, elementTypeOf<E>(), hash };
+        auto value = cache->template findValue<std::remove_const_t<V>>(key);
+        if (!value)
+        {
+            value = compute();
+            cache->insertValue(key, value);
+        }
+        return value;
+    };
+    const auto factorization = [&](const Value& value) {
+        return sharedValue(EvalCache::LU_FACTORIZATION, hashOf(value),
+            [&] { return std::make_shared<const LuFactorization<E>>(at(value.reg)); });
+    };
+    const auto forked = [&](const Instruction& fork) {
+        if (!pool || pool->workerCount() < 2 || input.empty())
+            return false;
+        const auto n = static_cast<std::size_t>(input.front().size());
+        const auto cost = [&](int branch) { return n * n * (fork.elementwise[branch] + n * fork.products[branch]); };
+        return std::min(cost(0), cost(1)) >= PROGRAM_FORK_MIN_COST;
+    };
+
+    for (auto pc = begin; pc < end; ++pc)
+    {
+        const auto& instruction = m_code[pc];
+#if OOP2_PROFILE
+        // a Fork is not charged: its branches are timed themselves
+        times[pc] = 0;
+        const auto timer = ScopedTimer(times[pc]);
+#endif
+        if (instruction.code == OpCode::Fork)
+        {
+            // the branches write disjoint registers; run one after the other, the markers are no-ops
+            if (forked(instruction))
+            {
+                pool->invoke([&] { execute(state, pc + 1, instruction.split); },
+                    [&] { execute(state, instruction.split + 1, instruction.join); });
+                pc = instruction.join;
+            }
+            continue;
+        }
+        if (instruction.code == OpCode::Split || instruction.code == OpCode::Join)
+            continue;
+
+        const auto dst = static_cast<std::size_t>(instruction.dst);
+        auto& result = storage[dst];
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+            result.emplace(term(instruction.a) + term(instruction.b));
+            break;
+        case OpCode::Sub:
+            result.emplace(term(instruction.a) - term(instruction.b));
+            break;
+        case OpCode::Mul:
+            result.emplace(at(instruction.a.value.reg) * at(instruction.b.value.reg));
+            break;
+        case OpCode::Pow:
+        {
+            const auto square = [&](const Dense& previous, int j) {
+                return sharedValue(EvalCache::POWER_SQUARES, EvalCache::combine(hashOf(instruction.a.value), static_cast<std::uint64_t>(j)),
+                    [&] { return std::make_shared<const Dense>(powerProduct(previous, previous)); });
+            };
+            result.emplace(power(at(instruction.a.value.reg), instruction.exponent, square));
+            break;
+        }
+        case OpCode::Det:
+            result.emplace(factorization(instruction.a.value)->determinant());
+            break;
+        case OpCode::Inverse:
+            result.emplace(factorization(instruction.a.value)->inverse());
+            break;
+        case OpCode::Solve:
+            result.emplace(factorization(instruction.a.value)->solve(at(instruction.b.value.reg)));
+            break;
+        case OpCode::Materialize:
+            if (instruction.a.value.transposed && !instruction.a.value.scale)
+            {
+                // a temporary that is not read again is transposed where it is
+                auto& source = storage[static_cast<std::size_t>(instruction.a.value.reg)];
+                if (instruction.a.lastUse && source)
+                {
+                    result = std::move(source);
+                    source.reset();
+                    result->transposeInPlace();
+                }
+                else
+                    result.emplace(at(instruction.a.value.reg).Transpose());
+            }
+            else
+                result.emplace(term(instruction.a));
+            break;
+        case OpCode::Fork:
+        case OpCode::Split:
+        case OpCode::Join:
+            break;
+        case OpCode::MemoLookup:
+            if (cache && (!instruction.crossEvalOnly || cache->capacity() > 0))
+            {
+                const auto inputs = static_cast<std::uint64_t>(instruction.inputsEnd - instruction.inputsBegin);
+                auto hash = EvalCache::Digest{ inputs, inputs };
+                for (auto k = instruction.inputsBegin; k < instruction.inputsEnd; ++k)
+                    hash = EvalCache::combine(hash, hashOf(m_memoInputs[k].value));
+                const auto key = EvalCache::Key{ instruction.operation, elementTypeOf<E>(), hash };
+                if (auto hit = cache->template find<E>(key))
+                {
+                    registers[dst] = hit.get();
+                    shared[dst] = std::move(hit);
+                    for (auto k = instruction.inputsBegin; k < instruction.inputsEnd; ++k)
+                        release(m_memoInputs[k]);
+                    pc = instruction.skip - 1;
+                    continue;
+                }
+                keys[dst] = key;
+            }
+            continue;
+        case OpCode::MemoStore:
+        {
+            // the result of the block is read only here, so it can be moved
+            const auto src = static_cast<std::size_t>(instruction.a.value.reg);
+            if (keys[dst])
+            {
+                shared[dst] = storage[src] ? std::make_shared<const Dense>(std::move(*storage[src])) : std::make_shared<const Dense>(*registers[src]);
+                cache->insert(*keys[dst], shared[dst]);
+                registers[dst] = shared[dst].get();
+            }
+            else if (storage[src])
+            {
+                result = std::move(storage[src]);
+                registers[dst] = &*result;
+            }
+            else
+            {
+                shared[dst] = shared[src];
+                registers[dst] = registers[src];
+            }
+            storage[src].reset();
+            shared[src].reset();
+            continue;
+        }
+        }
+        registers[dst] = &*result;
+
+        release(instruction.a);
+        if (instruction.code != OpCode::Materialize)
+            release(instruction.b);
+    }
+}
+
+
+template <typename M>
+std::optional<Program::Matrix<typename M::value_type>> Program::runFixedSize(std::span<const M> input, const EvalCache* cache) const
+{
+    if (input.empty() || (cache && cache->capacity() > 0))
+        return std::nullopt;
+
+    static_assert(FIXED_MATRIX_MIN_SIZE == 2 && FIXED_MATRIX_MAX_SIZE == 4, "update the cases of runFixedSize");
+    switch (input.front().size())
+    {
+    case 2: return runFixed<2>(input);
+    case 3: return runFixed<3>(input);
+    case 4: return runFixed<4>(input);
+    default: return std::nullopt;
+    }
+}
+
+
+template <int N, typename M>
+Program::Matrix<typename M::value_type> Program::runFixed(std::span<const M> input) const
+{
+    using E = typename M::value_type;
+    using Fixed = FixedSquareMatrix<E, N>;
+    auto registers = PooledVector<Fixed>(static_cast<std::size_t>(m_registerCount));
+    for (int i = 0; i < m_inputCount; ++i)
+    {
+        registers[static_cast<std::size_t>(i)] = Fixed(input[static_cast<std::size_t>(i)].data());
+    }
+
+    // a view is read as SquareMatrix materializes it: transposed, then scaled
+    const auto read = [&](const Operand& operand) {
+        const auto& value = operand.value;
+        const auto& source = registers[static_cast<std::size_t>(value.reg)];
+        const auto matrix = value.transposed ? source.Transpose() : source;
+        return value.scale ? matrix * static_cast<E>(*value.scale) : matrix;
+    };
+
+    // the dst of a marker is not a register
+    const auto at = [&](int reg) -> Fixed& { return registers[static_cast<std::size_t>(reg)]; };
+#if OOP2_PROFILE
+    auto times = std::vector<std::int64_t>(m_code.size(), 0);
+#endif
+    for (std::size_t pc = 0; pc < m_code.size(); ++pc)
+    {
+        const auto& instruction = m_code[pc];
+#if OOP2_PROFILE
+        const auto timer = ScopedTimer(times[pc]);
+#endif
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+        case OpCode::Sub:
+        {
+            // a first: its range error is the one an eager evaluation reports
+            const auto a = read(instruction.a);
+            const auto b = read(instruction.b);
+            at(instruction.dst) = instruction.code == OpCode::Add ? a + b : a - b;
+            break;
+        }
+        case OpCode::Mul:
+            at(instruction.dst) = at(instruction.a.value.reg) * at(instruction.b.value.reg);
+            break;
+        case OpCode::Pow:
+            at(instruction.dst) = Fixed(power(at(instruction.a.value.reg).toSquareMatrix(), instruction.exponent).data());
+            break;
+        case OpCode::Det:
+            at(instruction.dst) = Fixed(LuFactorization<E>(at(instruction.a.value.reg).toSquareMatrix()).determinant().data());
+            break;
+        case OpCode::Inverse:
+            at(instruction.dst) = Fixed(LuFactorization<E>(at(instruction.a.value.reg).toSquareMatrix()).inverse().data());
+            break;
+        case OpCode::Solve:
+        {
+            const auto factorization = LuFactorization<E>(at(instruction.a.value.reg).toSquareMatrix());
+            at(instruction.dst) = Fixed(factorization.solve(at(instruction.b.value.reg).toSquareMatrix()).data());
+            break;
+        }
+        case OpCode::Materialize:
+        case OpCode::MemoStore:
+            at(instruction.dst) = read(instruction.a);
+            break;
+        case OpCode::MemoLookup:
+        case OpCode::Fork:
+        case OpCode::Split:
+        case OpCode::Join:
+            break;
+        }
+    }
+#if OOP2_PROFILE
+    profile(times, N, sizeof(E), true);
+#endif
+    return registers[static_cast<std::size_t>(m_result)].toSquareMatrix();
+}
+
+
+template <typename E>
+std::optional<Program::Matrix<E>> Program::runSparse(std::span<const Matrix<E>> input, const EvalCache* cache) const
+{
+    using Dense = Matrix<E>;
+    using Sparse = SparseMatrix<E>;
+    if (!sparseEnabled() || !m_products || input.empty() || input.front().size() < SPARSE_MIN_SIZE
+        || (cache && (cache->capacity() > 0 || m_sharedBlocks || m_factors)))
+        return std::nullopt;
+
+    // a register holds a sparse matrix, or a dense one (its own or an input)
+    struct Register
+    {
+        std::optional<Sparse> sparse;
+        std::optional<Dense> dense;
+        const Dense* matrix = nullptr;
+    };
+    auto registers = PooledVector<Register>(static_cast<std::size_t>(m_registerCount));
+    const auto limit = static_cast<std::size_t>(SPARSE_MAX_DENSITY * static_cast<double>(input.front().count()));
+    auto converted = false;
+    for (std::size_t i = 0; i < input.size(); ++i)
+    {
+        const auto view = MatrixView<E>(input[i].data(), input[i].size());
+        if (Sparse::countNonZeros(view, limit) <= limit)
+        {
+            registers[i].sparse.emplace(view);
+            converted = true;
+        }
+        else
+            registers[i].matrix = &input[i];
+    }
+    if (!converted)
+        return std::nullopt;
+
+    const auto at = [&](int reg) -> Register& { return registers[static_cast<std::size_t>(reg)]; };
+    const auto storeDense = [&](Register& dst, Dense&& matrix) {
+        dst.dense.emplace(std::move(matrix));
+        dst.matrix = &*dst.dense;
+    };
+    // a sparse result that filled in is not worth keeping in CSR form
+    const auto storeSparse = [&](Register& dst, Sparse&& matrix) {
+        if (matrix.nonZeros() <= limit)
+            dst.sparse.emplace(std::move(matrix));
+        else
+            storeDense(dst, matrix.toDense());
+    };
+    const auto term = [&](const Value& value) {
+        return MatrixTerm<E>(*at(value.reg).matrix, value.transposed, value.scale ? std::optional<E>(static_cast<E>(*value.scale)) : std::nullopt);
+    };
+    // a sparse view as SquareMatrix materializes it: transposed, then scaled (into view)
+    const auto read = [&](const Value& value, std::optional<Sparse>& view) -> const Sparse& {
+        const auto& source = *at(value.reg).sparse;
+        if (value.transposed)
+            view.emplace(source.Transpose());
+        if (value.scale)
+            view.emplace(Sparse::scale(view ? *view : source, static_cast<E>(*value.scale)));
+        return view ? *view : source;
+    };
+
+#if OOP2_PROFILE
+    auto times = std::vector<std::int64_t>(m_code.size(), 0);
+#endif
+    for (std::size_t pc = 0; pc < m_code.size(); ++pc)
+    {
+        const auto& instruction = m_code[pc];
+#if OOP2_PROFILE
+        const auto timer = ScopedTimer(times[pc]);
+#endif
+        const auto& a = instruction.a.value;
+        const auto& b = instruction.b.value;
+        switch (instruction.code)
+        {
+        case OpCode::Add:
+        case OpCode::Sub:
+        {
+            // a first: its range error is the one an eager evaluation reports
+            const auto subtract = instruction.code == OpCode::Sub;
+            auto& dst = at(instruction.dst);
+            auto lhsView = std::optional<Sparse>();
+            auto rhsView = std::optional<Sparse>();
+            if (at(a.reg).sparse && at(b.reg).sparse)
+            {
+                const auto& lhs = read(a, lhsView);
+                const auto& rhs = read(b, rhsView);
+                storeSparse(dst, subtract ? Sparse::sub(lhs, rhs) : Sparse::add(lhs, rhs));
+                break;
+            }
+
+            // the sparse operand is added dense
+            auto lhsDense = std::optional<Dense>();
+            auto rhsDense = std::optional<Dense>();
+            if (at(a.reg).sparse)
+                lhsDense.emplace(read(a, lhsView).toDense());
+            else if (a.checked() && b.checked() && at(b.reg).sparse)
+                lhsDense.emplace(term(a));
+            if (at(b.reg).sparse)
+                rhsDense.emplace(read(b, rhsView).toDense());
+            const auto lhs = lhsDense ? MatrixTerm<E>(*lhsDense) : term(a);
+            const auto rhs = rhsDense ? MatrixTerm<E>(*rhsDense) : term(b);
+            storeDense(dst, subtract ? Dense(lhs - rhs) : Dense(lhs + rhs));
+            break;
+        }
+        case OpCode::Mul:
+        {
+            auto& dst = at(instruction.dst);
+            const auto& lhs = at(a.reg);
+            const auto& rhs = at(b.reg);
+            if (lhs.sparse && rhs.sparse)
+                storeSparse(dst, Sparse::multiply(*lhs.sparse, *rhs.sparse));
+            else if (lhs.sparse)
+                storeDense(dst, Sparse::multiply(*lhs.sparse, *rhs.matrix));
+            else if (rhs.sparse)
+                storeDense(dst, Sparse::multiply(*lhs.matrix, *rhs.sparse));
+            else
+                storeDense(dst, *lhs.matrix * *rhs.matrix);
+            break;
+        }
+        case OpCode::Pow:
+        {
+            // the powers of a sparse matrix fill in: they are computed dense
+            auto& dst = at(instruction.dst);
+            const auto& base = at(a.reg);
+            storeDense(dst, base.sparse ? power(base.sparse->toDense(), instruction.exponent) : power(*base.matrix, instruction.exponent));
+            break;
+        }
+        case OpCode::Det:
+        case OpCode::Inverse:
+        case OpCode::Solve:
+        {
+            // the factors of a sparse matrix fill in too
+            const auto dense = [&](const Value& value) { return at(value.reg).sparse ? at(value.reg).sparse->toDense() : *at(value.reg).matrix; };
+            const auto factorization = LuFactorization<E>(dense(a));
+            auto& dst = at(instruction.dst);
+            if (instruction.code == OpCode::Det)
+                storeDense(dst, factorization.determinant());
+            else if (instruction.code == OpCode::Inverse)
+                storeDense(dst, factorization.inverse());
+            else
+                storeDense(dst, factorization.solve(dense(b)));
+            break;
+        }
+        case OpCode::Materialize:
+        {
+            auto& dst = at(instruction.dst);
+            if (at(a.reg).sparse)
+            {
+                auto view = std::optional<Sparse>();
+                const auto& matrix = read(a, view);
+                storeSparse(dst, view ? std::move(*view) : Sparse(matrix));
+            }
+            else
+                storeDense(dst, Dense(term(a)));
+            break;
+        }
+        case OpCode::MemoStore:
+        {
+            // a block is not looked up: its result is only renamed
+            auto& dst = at(instruction.dst);
+            auto& source = at(a.reg);
+            if (a.reg < m_inputCount)
+                dst = source;
+            else
+            {
+                dst = std::move(source);
+                source = Register();
+                if (dst.dense)
+                    dst.matrix = &*dst.dense;
+            }
+            continue;
+        }
+        case OpCode::MemoLookup:
+        case OpCode::Fork:
+        case OpCode::Split:
+        case OpCode::Join:
+            continue;
+        }
+
+        if (instruction.a.lastUse)
+            at(a.reg) = Register();
+        if (instruction.b.lastUse && instruction.code != OpCode::Materialize)
+            at(b.reg) = Register();
+    }
+#if OOP2_PROFILE
+    profile(times, input.front().size(), sizeof(E), false);
+#endif
+
+    auto& result = at(m_result);
+    if (result.sparse)
+        return result.sparse->toDense();
+    return result.dense ? std::move(*result.dense) : *result.matrix;
+}
+
+
+#if OOP2_PROFILE
+void Program::profile(const std::vector<std::int64_t>& times, int size, std::size_t elementSize, bool fixed) const
+{
+    struct Cost
+    {
+        std::uint64_t ns = 0;
+        std::uint64_t bytes = 0;
+        std::uint64_t elements = 0;
+    };
+    auto costs = std::unordered_map<std::uint64_t, Cost>();
+
+    const auto n = static_cast<std::uint64_t>(size);
+    for (std::size_t pc = 0; pc < m_code.size(); ++pc)
+    {
+        const auto& instruction = m_code[pc];
+        if (times[pc] < 0 || instruction.code == OpCode::Fork)
+            continue;
+
+        auto cost = Cost{ static_cast<std::uint64_t>(times[pc]), 0, 0 };
+        switch (instruction.code)
+        {
+        case OpCode::Mul:
+            cost.elements = n * n * n;
+            break;
+        case OpCode::Pow:
+            cost.elements = n * n * n * static_cast<std::uint64_t>(powerProducts(instruction.exponent));
+            break;
+        case OpCode::Det:
+            cost.elements = n * n * n;
+            break;
+        case OpCode::Inverse:
+        case OpCode::Solve:
+            cost.elements = 2 * n * n * n;
+            break;
+        case OpCode::Add:
+        case OpCode::Sub:
+        case OpCode::Materialize:
+            cost.elements = n * n;
+            break;
+        default:
+            break;
+        }
+        // fixed-size registers are not on the heap; a transposed temporary is transposed in place
+        const auto inPlace = instruction.code == OpCode::Materialize && instruction.a.lastUse
+            && instruction.a.value.transposed && !instruction.a.value.scale;
+        if (cost.elements != 0 && !fixed && !inPlace)
+            cost.bytes = n * n * elementSize;
+
+        for (const auto operation : m_owners[instruction.owners])
+        {
+            auto& total = costs[operation];
+            total.ns += cost.ns;
+            total.bytes += cost.bytes;
+            total.elements += cost.elements;
+        }
+    }
+
+    for (const auto& [operation, cost] : costs)
+        Profiler::record(operation, cost.ns, cost.bytes, cost.elements);
+}
+#endif
+
+
+// the element types of ElementType
+template Program::Matrix<int> Program::run(std::span<const Matrix<int>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<std::int64_t> Program::run(std::span<const Matrix<std::int64_t>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<float> Program::run(std::span<const Matrix<float>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<double> Program::run(std::span<const Matrix<double>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<int> Program::run(std::span<const MatrixView<int>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<std::int64_t> Program::run(std::span<const MatrixView<std::int64_t>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<float> Program::run(std::span<const MatrixView<float>>, EvalCache*, ThreadPool*) const;
+template Program::Matrix<double> Program::run(std::span<const MatrixView<double>>, EvalCache*, ThreadPool*) const;
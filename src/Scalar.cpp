@@ -9,12 +9,32 @@ Scalar::Scalar(int scalar)
 }
 
 
-Operation::T Scalar::compute(const std::vector<T>& input) const
+Operation::T Scalar::compute(Input input) const
 {
     return input.front() * m_scalar;
 }
 
 
+std::optional<Operation::Term> Scalar::term(Input input) const
+{
+    return Term(input.front(), false, m_scalar);
+}
+
+
+Operation::Structure Scalar::structure() const
+{
+    return Structure{ typeid(*this), m_scalar, {} };
+}
+
+
+Program::Value Scalar::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    auto result = builder.plain(input.front());
+    result.scale = m_scalar;
+    return result;
+}
+
+
 void Scalar::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
@@ -0,0 +1,559 @@
+#include "SimdKernels.h"
+#include "MatrixKernels.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define SIMD_TARGET_AVX2
+#else
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#else
+#define SIMD_KERNELS_X86 0
+#endif
+
+
+namespace
+{
+    // the kernels of one element type
+    template <typename T>
+    struct KernelSet
+    {
+        bool (*add)(const T*, const T*, T*, std::size_t, T, T);
+        bool (*sub)(const T*, const T*, T*, std::size_t, T, T);
+        bool (*scale)(const T*, T, T*, std::size_t, T, T);
+        void (*gemm)(int, const T*, const T*, T*);
+        void (*subtractProducts)(int, const T*, const T*, T*, int, int, int, int, int, int);
+    };
+
+    // The inputs x for which x * scalar lies in the open interval (lo, hi).
+    // Checking the input instead of the product keeps the test exact even
+    // when the product would overflow.
+    void scaleInputRange(int scalar, int lo, int hi, int& xMin, int& xMax)
+    {
+        const auto floorDiv = [](long long a, long long b) { auto q = a / b; return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q; };
+        const auto ceilDiv = [](long long a, long long b) { auto q = a / b; return (a % b != 0 && ((a < 0) == (b < 0))) ? q + 1 : q; };
+        const auto clampInt = [](long long v) { return static_cast<int>(std::clamp<long long>(v, std::numeric_limits<int>::min(), std::numeric_limits<int>::max())); };
+
+        long long first = std::numeric_limits<int>::min();
+        long long last = std::numeric_limits<int>::max();
+        if (scalar > 0)
+        {
+            first = ceilDiv(lo + 1LL, scalar);
+            last = floorDiv(hi - 1LL, scalar);
+        }
+        else if (scalar < 0)
+        {
+            first = ceilDiv(hi - 1LL, scalar);
+            last = floorDiv(lo + 1LL, scalar);
+        }
+        else if (lo >= 0 || hi <= 0)
+        {
+            first = 1; // 0 is out of range: nothing is valid
+            last = 0;
+        }
+        xMin = clampInt(first);
+        xMax = clampInt(last);
+    }
+
+    // ---- scalar fallback: branch free so the compiler may still vectorize it
+
+    bool addScalar(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+    {
+        auto bad = 0u;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto sum = static_cast<int>(static_cast<unsigned>(a[i]) + static_cast<unsigned>(b[i]));
+            bad |= static_cast<unsigned>(sum <= lo) | static_cast<unsigned>(sum >= hi)
+                | (static_cast<unsigned>((a[i] ^ sum) & (b[i] ^ sum)) >> 31);
+            out[i] = sum;
+        }
+        return bad == 0;
+    }
+
+    bool subScalar(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+    {
+        auto bad = 0u;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const auto diff = static_cast<int>(static_cast<unsigned>(a[i]) - static_cast<unsigned>(b[i]));
+            bad |= static_cast<unsigned>(diff <= lo) | static_cast<unsigned>(diff >= hi)
+                | (static_cast<unsigned>((a[i] ^ b[i]) & (a[i] ^ diff)) >> 31);
+            out[i] = diff;
+        }
+        return bad == 0;
+    }
+
+    bool scaleScalar(const int* a, int scalar, int* out, std::size_t count, int lo, int hi)
+    {
+        int xMin, xMax;
+        scaleInputRange(scalar, lo, hi, xMin, xMax);
+        auto bad = 0u;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            bad |= static_cast<unsigned>(a[i] < xMin) | static_cast<unsigned>(a[i] > xMax);
+            out[i] = static_cast<int>(static_cast<unsigned>(a[i]) * static_cast<unsigned>(scalar));
+        }
+        return bad == 0;
+    }
+
+    template <typename T>
+    void gemmScalar(int n, const T* a, const T* b, T* c)
+    {
+        kernels::gemm(n, a, b, c);
+    }
+
+    // float and double: the generic loops, which the compiler vectorizes for the target's baseline
+    template <typename T>
+    constexpr KernelSet<T> genericKernels()
+    {
+        return KernelSet<T>{ kernels::addInRange<T>, kernels::subInRange<T>, kernels::scaleInRange<T>, gemmScalar<T>, kernels::subtractProductsTile<T> };
+    }
+
+#if SIMD_KERNELS_X86
+    // ---- SSE2 (always available on x86-64)
+
+    // lanes of v outside the open interval (lo, hi): v < lo + 1 or v > hi - 1
+    inline __m128i outOfRange(__m128i v, __m128i loPlus1, __m128i hiMinus1)
+    {
+        return _mm_or_si128(_mm_cmplt_epi32(v, loPlus1), _mm_cmpgt_epi32(v, hiMinus1));
+    }
+
+    // 32 bit multiply keeping the low half (pmulld is SSE4.1)
+    inline __m128i mulLo(__m128i a, __m128i b)
+    {
+        const auto even = _mm_mul_epu32(a, b);
+        const auto odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    template <bool Subtract>
+    bool addSubSse2(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+    {
+        const auto loPlus1 = _mm_set1_epi32(lo + 1);
+        const auto hiMinus1 = _mm_set1_epi32(hi - 1);
+        auto bad = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            const auto r = Subtract ? _mm_sub_epi32(x, y) : _mm_add_epi32(x, y);
+            const auto overflow = Subtract
+                ? _mm_and_si128(_mm_xor_si128(x, y), _mm_xor_si128(x, r))
+                : _mm_and_si128(_mm_xor_si128(x, r), _mm_xor_si128(y, r));
+            bad = _mm_or_si128(bad, _mm_or_si128(outOfRange(r, loPlus1, hiMinus1), _mm_srai_epi32(overflow, 31)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), r);
+        }
+        const auto tailOk = Subtract ? subScalar(a + i, b + i, out + i, count - i, lo, hi)
+                                     : addScalar(a + i, b + i, out + i, count - i, lo, hi);
+        return tailOk && _mm_movemask_epi8(bad) == 0;
+    }
+
+    bool scaleSse2(const int* a, int scalar, int* out, std::size_t count, int lo, int hi)
+    {
+        int xMin, xMax;
+        scaleInputRange(scalar, lo, hi, xMin, xMax);
+        const auto vMin = _mm_set1_epi32(xMin);
+        const auto vMax = _mm_set1_epi32(xMax);
+        const auto s = _mm_set1_epi32(scalar);
+        auto bad = _mm_setzero_si128();
+        std::size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            bad = _mm_or_si128(bad, _mm_or_si128(_mm_cmplt_epi32(x, vMin), _mm_cmpgt_epi32(x, vMax)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), mulLo(x, s));
+        }
+        return scaleScalar(a + i, scalar, out + i, count - i, lo, hi) && _mm_movemask_epi8(bad) == 0;
+    }
+
+    // ---- AVX2
+
+    template <bool Subtract>
+    SIMD_TARGET_AVX2 bool addSubAvx2(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+    {
+        const auto loPlus1 = _mm256_set1_epi32(lo + 1);
+        const auto hiMinus1 = _mm256_set1_epi32(hi - 1);
+        auto bad = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            const auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+            const auto r = Subtract ? _mm256_sub_epi32(x, y) : _mm256_add_epi32(x, y);
+            const auto overflow = Subtract
+                ? _mm256_and_si256(_mm256_xor_si256(x, y), _mm256_xor_si256(x, r))
+                : _mm256_and_si256(_mm256_xor_si256(x, r), _mm256_xor_si256(y, r));
+            const auto range = _mm256_or_si256(_mm256_cmpgt_epi32(loPlus1, r), _mm256_cmpgt_epi32(r, hiMinus1));
+            bad = _mm256_or_si256(bad, _mm256_or_si256(range, _mm256_srai_epi32(overflow, 31)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), r);
+        }
+        const auto tailOk = addSubSse2<Subtract>(a + i, b + i, out + i, count - i, lo, hi);
+        return tailOk && _mm256_testz_si256(bad, bad);
+    }
+
+    SIMD_TARGET_AVX2 bool scaleAvx2(const int* a, int scalar, int* out, std::size_t count, int lo, int hi)
+    {
+        int xMin, xMax;
+        scaleInputRange(scalar, lo, hi, xMin, xMax);
+        const auto vMin = _mm256_set1_epi32(xMin);
+        const auto vMax = _mm256_set1_epi32(xMax);
+        const auto s = _mm256_set1_epi32(scalar);
+        auto bad = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+            bad = _mm256_or_si256(bad, _mm256_or_si256(_mm256_cmpgt_epi32(vMin, x), _mm256_cmpgt_epi32(x, vMax)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_mullo_epi32(x, s));
+        }
+        return scaleSse2(a + i, scalar, out + i, count - i, lo, hi) && _mm256_testz_si256(bad, bad);
+    }
+
+    // Same blocking as kernels::gemm; the micro kernel updates a 4 x 8 block
+    // of c per step, keeping it in registers across the whole k range
+    SIMD_TARGET_AVX2 void gemmTileAvx2(int n, const int* a, const int* b, int* c, int i0, int i1, int k0, int k1, int j0, int j1)
+    {
+        const auto stride = static_cast<std::size_t>(n);
+        auto i = i0;
+        for (; i + 4 <= i1; i += 4)
+        {
+            const int* a0 = a + static_cast<std::size_t>(i) * stride;
+            int* c0 = c + static_cast<std::size_t>(i) * stride;
+            auto j = j0;
+            for (; j + 8 <= j1; j += 8)
+            {
+                auto r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c0 + j));
+                auto r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c0 + stride + static_cast<std::size_t>(j)));
+                auto r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c0 + 2 * stride + static_cast<std::size_t>(j)));
+                auto r3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c0 + 3 * stride + static_cast<std::size_t>(j)));
+                for (int k = k0; k < k1; ++k)
+                {
+                    const auto y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + static_cast<std::size_t>(k) * stride + static_cast<std::size_t>(j)));
+                    const auto kk = static_cast<std::size_t>(k);
+                    r0 = _mm256_add_epi32(r0, _mm256_mullo_epi32(_mm256_set1_epi32(a0[kk]), y));
+                    r1 = _mm256_add_epi32(r1, _mm256_mullo_epi32(_mm256_set1_epi32(a0[stride + kk]), y));
+                    r2 = _mm256_add_epi32(r2, _mm256_mullo_epi32(_mm256_set1_epi32(a0[2 * stride + kk]), y));
+                    r3 = _mm256_add_epi32(r3, _mm256_mullo_epi32(_mm256_set1_epi32(a0[3 * stride + kk]), y));
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c0 + j), r0);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c0 + stride + static_cast<std::size_t>(j)), r1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c0 + 2 * stride + static_cast<std::size_t>(j)), r2);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(c0 + 3 * stride + static_cast<std::size_t>(j)), r3);
+            }
+            if (j < j1)
+                kernels::gemmTile(n, a, b, c, i, i + 4, k0, k1, j, j1);
+        }
+        if (i < i1)
+            kernels::gemmTile(n, a, b, c, i, i1, k0, k1, j0, j1);
+    }
+
+    // ---- AVX2 for float and double: the same code for 8 floats or 4 doubles a vector
+
+    SIMD_TARGET_AVX2 inline __m256 load(const float* p) { return _mm256_loadu_ps(p); }
+    SIMD_TARGET_AVX2 inline __m256d load(const double* p) { return _mm256_loadu_pd(p); }
+    SIMD_TARGET_AVX2 inline void store(float* p, __m256 v) { _mm256_storeu_ps(p, v); }
+    SIMD_TARGET_AVX2 inline void store(double* p, __m256d v) { _mm256_storeu_pd(p, v); }
+    SIMD_TARGET_AVX2 inline __m256 broadcast(float x) { return _mm256_set1_ps(x); }
+    SIMD_TARGET_AVX2 inline __m256d broadcast(double x) { return _mm256_set1_pd(x); }
+    SIMD_TARGET_AVX2 inline __m256 plus(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+    SIMD_TARGET_AVX2 inline __m256d plus(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+    SIMD_TARGET_AVX2 inline __m256 minus(__m256 a, __m256 b) { return _mm256_sub_ps(a, b); }
+    SIMD_TARGET_AVX2 inline __m256d minus(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+    SIMD_TARGET_AVX2 inline __m256 times(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+    SIMD_TARGET_AVX2 inline __m256d times(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+
+    // bad | the lanes of v outside the open interval (lo, hi), as the generic loops test it
+    SIMD_TARGET_AVX2 inline __m256 outOfRange(__m256 bad, __m256 v, __m256 lo, __m256 hi)
+    {
+        return _mm256_or_ps(bad, _mm256_or_ps(_mm256_cmp_ps(v, lo, _CMP_LE_OQ), _mm256_cmp_ps(v, hi, _CMP_GE_OQ)));
+    }
+    SIMD_TARGET_AVX2 inline __m256d outOfRange(__m256d bad, __m256d v, __m256d lo, __m256d hi)
+    {
+        return _mm256_or_pd(bad, _mm256_or_pd(_mm256_cmp_pd(v, lo, _CMP_LE_OQ), _mm256_cmp_pd(v, hi, _CMP_GE_OQ)));
+    }
+    SIMD_TARGET_AVX2 inline bool none(__m256 mask) { return _mm256_movemask_ps(mask) == 0; }
+    SIMD_TARGET_AVX2 inline bool none(__m256d mask) { return _mm256_movemask_pd(mask) == 0; }
+
+    template <typename T, bool Subtract>
+    SIMD_TARGET_AVX2 bool addSubFloatAvx2(const T* a, const T* b, T* out, std::size_t count, T lo, T hi)
+    {
+        constexpr auto lanes = 32 / sizeof(T);
+        const auto vLo = broadcast(lo);
+        const auto vHi = broadcast(hi);
+        auto bad = decltype(vLo){};
+        std::size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const auto r = Subtract ? minus(load(a + i), load(b + i)) : plus(load(a + i), load(b + i));
+            bad = outOfRange(bad, r, vLo, vHi);
+            store(out + i, r);
+        }
+        const auto tailOk = Subtract ? kernels::subInRange<T>(a + i, b + i, out + i, count - i, lo, hi)
+                                     : kernels::addInRange<T>(a + i, b + i, out + i, count - i, lo, hi);
+        return tailOk && none(bad);
+    }
+
+    template <typename T>
+    SIMD_TARGET_AVX2 bool scaleFloatAvx2(const T* a, T scalar, T* out, std::size_t count, T lo, T hi)
+    {
+        constexpr auto lanes = 32 / sizeof(T);
+        const auto vLo = broadcast(lo);
+        const auto vHi = broadcast(hi);
+        const auto s = broadcast(scalar);
+        auto bad = decltype(vLo){};
+        std::size_t i = 0;
+        for (; i + lanes <= count; i += lanes)
+        {
+            const auto r = times(load(a + i), s);
+            bad = outOfRange(bad, r, vLo, vHi);
+            store(out + i, r);
+        }
+        return kernels::scaleInRange<T>(a + i, scalar, out + i, count - i, lo, hi) && none(bad);
+    }
+
+    // The micro kernel above for float and double: a 4 x (8 floats / 4 doubles)
+    // block of c, with a multiply and an add per step (not a fused one)
+    template <typename T>
+    SIMD_TARGET_AVX2 void gemmTileAvx2(int n, const T* a, const T* b, T* c, int i0, int i1, int k0, int k1, int j0, int j1)
+    {
+        constexpr auto lanes = static_cast<int>(32 / sizeof(T));
+        const auto stride = static_cast<std::size_t>(n);
+        auto i = i0;
+        for (; i + 4 <= i1; i += 4)
+        {
+            const T* a0 = a + static_cast<std::size_t>(i) * stride;
+            T* c0 = c + static_cast<std::size_t>(i) * stride;
+            auto j = j0;
+            for (; j + lanes <= j1; j += lanes)
+            {
+                const auto jj = static_cast<std::size_t>(j);
+                auto r0 = load(c0 + jj);
+                auto r1 = load(c0 + stride + jj);
+                auto r2 = load(c0 + 2 * stride + jj);
+                auto r3 = load(c0 + 3 * stride + jj);
+                for (int k = k0; k < k1; ++k)
+                {
+                    const auto kk = static_cast<std::size_t>(k);
+                    const auto y = load(b + kk * stride + jj);
+                    r0 = plus(r0, times(broadcast(a0[kk]), y));
+                    r1 = plus(r1, times(broadcast(a0[stride + kk]), y));
+                    r2 = plus(r2, times(broadcast(a0[2 * stride + kk]), y));
+                    r3 = plus(r3, times(broadcast(a0[3 * stride + kk]), y));
+                }
+                store(c0 + jj, r0);
+                store(c0 + stride + jj, r1);
+                store(c0 + 2 * stride + jj, r2);
+                store(c0 + 3 * stride + jj, r3);
+            }
+            if (j < j1)
+                kernels::gemmTile(n, a, b, c, i, i + 4, k0, k1, j, j1);
+        }
+        if (i < i1)
+            kernels::gemmTile(n, a, b, c, i, i1, k0, k1, j0, j1);
+    }
+
+    // kernels::subtractProductsTile on a 4 x (8 floats / 4 doubles) block of
+    // c at a time, kept in registers over the whole depth
+    template <typename T>
+    SIMD_TARGET_AVX2 void subtractProductsAvx2(int n, const T* a, const T* b, T* c, int i0, int i1, int k0, int k1, int j0, int j1)
+    {
+        constexpr auto lanes = static_cast<int>(32 / sizeof(T));
+        const auto stride = static_cast<std::size_t>(n);
+        auto i = i0;
+        for (; i + 4 <= i1; i += 4)
+        {
+            const T* a0 = a + static_cast<std::size_t>(i) * stride;
+            T* c0 = c + static_cast<std::size_t>(i) * stride;
+            auto j = j0;
+            for (; j + lanes <= j1; j += lanes)
+            {
+                const auto jj = static_cast<std::size_t>(j);
+                auto r0 = load(c0 + jj);
+                auto r1 = load(c0 + stride + jj);
+                auto r2 = load(c0 + 2 * stride + jj);
+                auto r3 = load(c0 + 3 * stride + jj);
+                for (int k = k0; k < k1; ++k)
+                {
+                    const auto kk = static_cast<std::size_t>(k);
+                    const auto y = load(b + kk * stride + jj);
+                    r0 = minus(r0, times(broadcast(a0[kk]), y));
+                    r1 = minus(r1, times(broadcast(a0[stride + kk]), y));
+                    r2 = minus(r2, times(broadcast(a0[2 * stride + kk]), y));
+                    r3 = minus(r3, times(broadcast(a0[3 * stride + kk]), y));
+                }
+                store(c0 + jj, r0);
+                store(c0 + stride + jj, r1);
+                store(c0 + 2 * stride + jj, r2);
+                store(c0 + 3 * stride + jj, r3);
+            }
+            if (j < j1)
+                kernels::subtractProductsTile(n, a, b, c, i, i + 4, k0, k1, j, j1);
+        }
+        if (i < i1)
+            kernels::subtractProductsTile(n, a, b, c, i, i1, k0, k1, j0, j1);
+    }
+
+    // kernels::gemm with the AVX2 micro kernel of T
+    template <typename T>
+    SIMD_TARGET_AVX2 void gemmAvx2(int n, const T* a, const T* b, T* c)
+    {
+        std::fill(c, c + static_cast<std::size_t>(n) * static_cast<std::size_t>(n), T());
+        for (int jj = 0; jj < n; jj += kernels::GEMM_NC)
+        {
+            const auto jEnd = std::min(jj + kernels::GEMM_NC, n);
+            for (int kk = 0; kk < n; kk += kernels::GEMM_KC)
+            {
+                const auto kEnd = std::min(kk + kernels::GEMM_KC, n);
+                for (int ii = 0; ii < n; ii += kernels::GEMM_MC)
+                {
+                    gemmTileAvx2(n, a, b, c, ii, std::min(ii + kernels::GEMM_MC, n), kk, kEnd, jj, jEnd);
+                }
+            }
+        }
+    }
+
+    bool cpuHasAvx2()
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5));
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+    enum class Level { Scalar, Sse2, Avx2 };
+
+    Level detectLevel()
+    {
+#if SIMD_KERNELS_X86
+        return cpuHasAvx2() ? Level::Avx2 : Level::Sse2;
+#else
+        return Level::Scalar;
+#endif
+    }
+
+    struct Dispatch
+    {
+        Level level;
+        KernelSet<int> ints;
+        KernelSet<float> floats;
+        KernelSet<double> doubles;
+    };
+
+    const Dispatch& dispatch()
+    {
+        static const Dispatch table = [] {
+            const auto level = detectLevel();
+            switch (level)
+            {
+#if SIMD_KERNELS_X86
+            case Level::Avx2: return Dispatch{ level,
+                { addSubAvx2<false>, addSubAvx2<true>, scaleAvx2, gemmAvx2<int>, kernels::subtractProductsTile<int> },
+                { addSubFloatAvx2<float, false>, addSubFloatAvx2<float, true>, scaleFloatAvx2<float>, gemmAvx2<float>, subtractProductsAvx2<float> },
+                { addSubFloatAvx2<double, false>, addSubFloatAvx2<double, true>, scaleFloatAvx2<double>, gemmAvx2<double>, subtractProductsAvx2<double> } };
+            case Level::Sse2: return Dispatch{ level, { addSubSse2<false>, addSubSse2<true>, scaleSse2, gemmScalar<int>, kernels::subtractProductsTile<int> },
+                genericKernels<float>(), genericKernels<double>() };
+#endif
+            default:          return Dispatch{ level, { addScalar, subScalar, scaleScalar, gemmScalar<int>, kernels::subtractProductsTile<int> },
+                genericKernels<float>(), genericKernels<double>() };
+            }
+        }();
+        return table;
+    }
+}
+
+
+bool kernels::addInRange(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+{
+    return dispatch().ints.add(a, b, out, count, lo, hi);
+}
+
+bool kernels::subInRange(const int* a, const int* b, int* out, std::size_t count, int lo, int hi)
+{
+    return dispatch().ints.sub(a, b, out, count, lo, hi);
+}
+
+bool kernels::scaleInRange(const int* a, int scalar, int* out, std::size_t count, int lo, int hi)
+{
+    return dispatch().ints.scale(a, scalar, out, count, lo, hi);
+}
+
+bool kernels::addInRange(const float* a, const float* b, float* out, std::size_t count, float lo, float hi)
+{
+    return dispatch().floats.add(a, b, out, count, lo, hi);
+}
+
+bool kernels::subInRange(const float* a, const float* b, float* out, std::size_t count, float lo, float hi)
+{
+    return dispatch().floats.sub(a, b, out, count, lo, hi);
+}
+
+bool kernels::scaleInRange(const float* a, float scalar, float* out, std::size_t count, float lo, float hi)
+{
+    return dispatch().floats.scale(a, scalar, out, count, lo, hi);
+}
+
+bool kernels::addInRange(const double* a, const double* b, double* out, std::size_t count, double lo, double hi)
+{
+    return dispatch().doubles.add(a, b, out, count, lo, hi);
+}
+
+bool kernels::subInRange(const double* a, const double* b, double* out, std::size_t count, double lo, double hi)
+{
+    return dispatch().doubles.sub(a, b, out, count, lo, hi);
+}
+
+bool kernels::scaleInRange(const double* a, double scalar, double* out, std::size_t count, double lo, double hi)
+{
+    return dispatch().doubles.scale(a, scalar, out, count, lo, hi);
+}
+
+void kernels::gemmInt(int n, const int* a, const int* b, int* c)
+{
+    dispatch().ints.gemm(n, a, b, c);
+}
+
+void kernels::gemmFloat(int n, const float* a, const float* b, float* c)
+{
+    dispatch().floats.gemm(n, a, b, c);
+}
+
+void kernels::gemmFloat(int n, const double* a, const double* b, double* c)
+{
+    dispatch().doubles.gemm(n, a, b, c);
+}
+
+void kernels::subtractProducts(int n, const float* a, const float* b, float* c, int i0, int i1, int k0, int k1, int j0, int j1)
+{
+    dispatch().floats.subtractProducts(n, a, b, c, i0, i1, k0, k1, j0, j1);
+}
+
+void kernels::subtractProducts(int n, const double* a, const double* b, double* c, int i0, int i1, int k0, int k1, int j0, int j1)
+{
+    dispatch().doubles.subtractProducts(n, a, b, c, i0, i1, k0, k1, j0, j1);
+}
+
+const char* kernels::simdLevel()
+{
+    switch (dispatch().level)
+    {
+    case Level::Avx2: return "avx2";
+    case Level::Sse2: return "sse2";
+    default:          return "scalar";
+    }
+}
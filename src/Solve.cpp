@@ -0,0 +1,30 @@
+#include "Solve.h"
+#include "LuFactorization.h"
+
+#include <iostream>
+
+
+Operation::T Solve::compute(Input input) const
+{
+    const auto a = first()->compute(input);
+    const auto b = second()->compute(secondInput(input));
+
+    return LuFactorization<int>(a).solve(b);
+}
+
+
+Program::Value Solve::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    const auto fork = builder.fork();
+    const auto a = builder.plain(builder.compile(*first(), input.first(static_cast<std::size_t>(firstCount()))));
+    builder.split(fork);
+    const auto b = builder.plain(builder.compile(*second(), input.subspan(static_cast<std::size_t>(firstCount()))));
+    builder.join(fork);
+    return builder.emit(Program::OpCode::Solve, a, b);
+}
+
+
+void Solve::printSymbol(std::ostream& ostr) const
+{
+    ostr << '\\';
+}
@@ -0,0 +1,191 @@
+#include "ThreadPool.h"
+
+
+namespace
+{
+    // the pool and the queue of the worker running on this thread
+    thread_local const ThreadPool* currentPool = nullptr;
+    thread_local std::size_t currentQueue = 0;
+}
+
+
+ThreadPool::ThreadPool(int workers)
+{
+    const auto count = static_cast<std::size_t>(workers < 1 ? 1 : workers);
+    for (std::size_t i = 0; i <= count; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        m_workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+
+int ThreadPool::defaultWorkerCount()
+{
+    const auto count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : static_cast<int>(count);
+}
+
+
+void ThreadPool::invoke(const std::function<void()>& first, const std::function<void()>& second)
+{
+    auto task = Task{ &second, nullptr, false };
+    push(&task);
+
+    auto error = std::exception_ptr();
+    try
+    {
+        first();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    // second refers to the caller's frame: wait for it even if first threw
+    while (!task.done.load(std::memory_order_acquire))
+    {
+        if (auto* other = take())
+        {
+            execute(other);
+            continue;
+        }
+
+        // it is running on another thread: sleep until a task is done or pushed
+        auto lock = std::unique_lock(m_mutex);
+        m_finished.wait(lock, [&] { return task.done.load(std::memory_order_acquire) || m_pending > 0; });
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+    if (task.error)
+        std::rethrow_exception(task.error);
+}
+
+
+void ThreadPool::forEach(std::size_t count, const std::function<void(std::size_t)>& body)
+{
+    forEach(0, count, body);
+}
+
+
+void ThreadPool::forEach(std::size_t begin, std::size_t end, const std::function<void(std::size_t)>& body)
+{
+    if (end - begin <= 1)
+    {
+        if (begin != end)
+            body(begin);
+        return;
+    }
+    const auto middle = begin + (end - begin) / 2;
+    invoke([&] { forEach(begin, middle, body); }, [&] { forEach(middle, end, body); });
+}
+
+
+std::size_t ThreadPool::ownQueue() const
+{
+    return currentPool == this ? currentQueue : m_workers.size();
+}
+
+
+void ThreadPool::push(Task* task)
+{
+    // counted first, so that take() never sees more tasks than m_pending
+    {
+        const auto lock = std::lock_guard(m_mutex);
+        ++m_pending;
+    }
+    auto& queue = *m_queues[ownQueue()];
+    {
+        const auto lock = std::lock_guard(queue.mutex);
+        queue.tasks.push_back(task);
+    }
+    m_wake.notify_one();
+    m_finished.notify_all();
+}
+
+
+ThreadPool::Task* ThreadPool::take()
+{
+    const auto own = ownQueue();
+    {
+        auto& queue = *m_queues[own];
+        const auto lock = std::lock_guard(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            auto* task = queue.tasks.back();
+            queue.tasks.pop_back();
+            --m_pending;
+            return task;
+        }
+    }
+    for (std::size_t i = 1; i < m_queues.size(); ++i)
+    {
+        auto& queue = *m_queues[(own + i) % m_queues.size()];
+        const auto lock = std::lock_guard(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            auto* task = queue.tasks.front();
+            queue.tasks.pop_front();
+            --m_pending;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+
+void ThreadPool::execute(Task* task)
+{
+    try
+    {
+        (*task->work)();
+    }
+    catch (...)
+    {
+        task->error = std::current_exception();
+    }
+    task->done.store(true, std::memory_order_release);
+    // a waiter between its check and its wait holds the lock: it is woken too
+    {
+        const auto lock = std::lock_guard(m_mutex);
+    }
+    m_finished.notify_all();
+}
+
+
+void ThreadPool::work(std::size_t index)
+{
+    currentPool = this;
+    currentQueue = index;
+    while (true)
+    {
+        if (auto* task = take())
+        {
+            execute(task);
+            continue;
+        }
+
+        auto lock = std::unique_lock(m_mutex);
+        m_wake.wait(lock, [this] { return m_stop || m_pending > 0; });
+        if (m_stop)
+            return;
+    }
+}
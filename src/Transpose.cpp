@@ -1,12 +1,33 @@
 #include "Transpose.h"
 
 
-Operation::T Transpose::compute(const std::vector<T>& input) const
+Operation::T Transpose::compute(Input input) const
 {
     return input.front().Transpose();
 }
 
 
+Operation::T Transpose::consume(T input) const
+{
+    input.transposeInPlace();
+    return input;
+}
+
+
+std::optional<Operation::Term> Transpose::term(Input input) const
+{
+    return Term(input.front(), true);
+}
+
+
+Program::Value Transpose::compile(Program::Builder& builder, std::span<const Program::Value> input) const
+{
+    auto result = builder.plain(input.front());
+    result.transposed = true;
+    return result;
+}
+
+
 void Transpose::print(std::ostream& ostr, bool first_print) const
 {
     (void)first_print; // Cast to void to avoid unused parameter warning
@@ -6,6 +6,11 @@ UnaryOperation::UnaryOperation()
 }
 
 
+UnaryOperation::~UnaryOperation()
+{
+}
+
+
 int UnaryOperation::inputCount() const
 {
 	return 1;
@@ -1,22 +1,102 @@
 #include "FunctionCalculator.h"
+#include "BufferedOutput.h"
 
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <optional>
 
 
+namespace
+{
+	// oop2_ex03 --script FILE [--on-error abort|skip|log] - runs the commands
+	// of FILE (- for the standard input) without the menu and the prompts
+	int runScript(int argc, char* argv[])
+	{
+		auto path = std::optional<std::string>();
+		auto policy = FunctionCalculator::ErrorPolicy::Abort;
+		for (int i = 1; i < argc; ++i)
+		{
+			const auto arg = std::string(argv[i]);
+			const auto hasValue = i + 1 < argc;
+			if (arg == "--script" && hasValue)
+				path = argv[++i];
+			else if (arg == "--on-error" && hasValue)
+			{
+				const auto value = std::string(argv[++i]);
+				if (value == "abort")
+					policy = FunctionCalculator::ErrorPolicy::Abort;
+				else if (value == "skip")
+					policy = FunctionCalculator::ErrorPolicy::Skip;
+				else if (value == "log")
+					policy = FunctionCalculator::ErrorPolicy::Log;
+				else
+				{
+					std::cerr << "--on-error expects abort, skip or log\n";
+					return 2;
+				}
+			}
+			else
+			{
+				std::cerr << "usage: oop2_ex03 --script FILE [--on-error abort|skip|log]\n";
+				return 2;
+			}
+		}
+		if (!path)
+		{
+			std::cerr << "usage: oop2_ex03 --script FILE [--on-error abort|skip|log]\n";
+			return 2;
+		}
+
+		auto file = std::ifstream();
+		if (*path != "-")
+		{
+			file.open(*path);
+			if (!file.is_open())
+			{
+				std::cerr << "File not found. \n path: " << *path << '\n';
+				return 2;
+			}
+		}
+		auto& input = *path == "-" ? std::cin : file;
+
+		// the whole output goes through one buffer, not through the console per line
+		std::ios::sync_with_stdio(false);
+		auto buffer = BufferedOutput(std::cout);
+		auto output = std::ostream(&buffer);
+		const auto ok = FunctionCalculator(output).runScript(input, policy);
+		return ok || policy == FunctionCalculator::ErrorPolicy::Skip ? 0 : 1;
+	}
+}
 
-int main()
+
+int main(int argc, char* argv[])
 {
-  
-    
+
+
 	try
 	{
+		if (argc > 1 && std::string(argv[1]).starts_with("--"))
+			return runScript(argc, argv);
+
+		// commands on the command line run without the menu, for example:
+		// oop2_ex03 "scal 2; beval 2 3 in.txt out.txt"
+		if (argc > 1)
+		{
+			auto commands = std::string();
+			for (int i = 1; i < argc; ++i)
+			{
+				commands += argv[i];
+				commands += ' ';
+			}
+			return FunctionCalculator(std::cout).run(commands) ? 0 : 1;
+		}
 		FunctionCalculator(std::cout).run();
 	}
 	catch (...)
 	{
 		std::cout << "\n ERROR";
 	}
-   
+
 
 }
@@ -0,0 +1,432 @@
+#include "Add.h"
+#include "Sub.h"
+#include "Mul.h"
+#include "Comp.h"
+#include "Identity.h"
+#include "Transpose.h"
+#include "Scalar.h"
+#include "Pow.h"
+#include "Det.h"
+#include "Inverse.h"
+#include "Solve.h"
+#include "LuFactorization.h"
+#include "SparseMatrix.h"
+#include "EvalCache.h"
+#include "OperationPool.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+// Builds random operation trees and checks that the compiled Program gives
+// what the recursive compute() gives - the same matrix, or the same error
+// message - with and without an EvalCache and a ThreadPool, on every element
+// type, on dense and mostly zero inputs, and for trees kept in an interning
+// OperationPool
+namespace
+{
+    class Generator
+    {
+    public:
+        explicit Generator(std::uint32_t seed) : m_random(seed) {}
+
+        int next(int count) { return std::uniform_int_distribution<int>(0, count - 1)(m_random); }
+
+        // a tree of the given depth, every node its own
+        const Operation& tree(int depth)
+        {
+            if (depth == 0 || next(3) == 0)
+                return leaf();
+            if (next(6) == 0)
+                return power(tree(depth - 1), 1 + next(6));
+            if (next(8) == 0)
+                return factored(tree(depth - 1));
+            const auto& first = tree(depth - 1);
+            const auto& second = tree(depth - 1);
+            return next(8) == 0 ? solve(first, second) : binary(first, second);
+        }
+
+        // a tree whose nodes are reused, so that the Program memoizes them
+        const Operation& shared(int count)
+        {
+            auto nodes = std::vector<const Operation*>{ &leaf(), &leaf(), &leaf() };
+            for (int i = 0; i < count; ++i)
+            {
+                const auto& first = *nodes[static_cast<std::size_t>(next(static_cast<int>(nodes.size())))];
+                const auto& second = *nodes[static_cast<std::size_t>(next(static_cast<int>(nodes.size())))];
+                switch (next(12))
+                {
+                case 0: nodes.push_back(&power(first, 1 + next(5))); break;
+                case 1: nodes.push_back(&factored(first)); break;
+                case 2: nodes.push_back(&solve(first, second)); break;
+                default: nodes.push_back(&binary(first, second)); break;
+                }
+            }
+            return *nodes.back();
+        }
+
+        // mostly up to 5 x 5; now and then past the blocks of the kernels
+        int size()
+        {
+            switch (next(16))
+            {
+            case 0: return 65 + next(8);
+            case 1: case 2: return 33 + next(8);
+            default: return 1 + next(5);
+            }
+        }
+
+        SquareMatrix<int> matrix(int size, int range)
+        {
+            auto result = SquareMatrix<int>(size, 0);
+            for (std::size_t i = 0; i < result.count(); ++i)
+                result.data()[i] = next(2 * range + 1) - range;
+            return result;
+        }
+
+        // a matrix with 1% to 3% of its values non-zero (in [-4, 4])
+        SquareMatrix<int> sparse(int size)
+        {
+            auto result = SquareMatrix<int>(size, 0);
+            const auto count = static_cast<int>(result.count()) * (1 + next(3)) / 100;
+            for (int k = 0; k < count; ++k)
+            {
+                const auto value = next(8) - 4;
+                result.data()[static_cast<std::size_t>(next(static_cast<int>(result.count())))] = value < 0 ? value : value + 1;
+            }
+            return result;
+        }
+
+        // frees the operations of the last tree
+        void clear()
+        {
+            m_nodes.clear();
+            m_powers = false;
+            m_factors = false;
+        }
+
+        // the last tree has a Pow, or a Det, Inverse or Solve
+        bool powers() const { return m_powers; }
+        bool factors() const { return m_factors; }
+
+        // a tree in pool, with a reference for the caller; its leaves have
+        // few parameters, so that equal subtrees are interned into one node
+        OperationHandle pooled(OperationPool& pool, int depth)
+        {
+            if (depth == 0 || next(3) == 0)
+            {
+                switch (next(3))
+                {
+                case 0: return pool.emplace<Identity>();
+                case 1: return pool.emplace<Transpose>();
+                default: return pool.emplace<Scalar>(next(3) - 1);
+                }
+            }
+            if (next(4) == 0)
+            {
+                const auto base = pooled(pool, depth - 1);
+                auto result = OperationHandle();
+                switch (next(4))
+                {
+                case 0: result = pool.apply<Det>(base); break;
+                case 1: result = pool.apply<Inverse>(base); break;
+                default: result = pool.apply<Pow>(base, 1 + next(3)); break;
+                }
+                pool.release(base);
+                return result;
+            }
+            const auto first = pooled(pool, depth - 1);
+            const auto second = pooled(pool, depth - 1);
+            auto result = OperationHandle();
+            switch (next(9))
+            {
+            case 0: case 1: result = pool.combine<Add>(first, second); break;
+            case 2: case 3: result = pool.combine<Sub>(first, second); break;
+            case 4: case 5: result = pool.combine<Mul>(first, second); break;
+            case 6: result = pool.combine<Solve>(first, second); break;
+            default: result = pool.combine<Comp>(first, second); break;
+            }
+            pool.release(first);
+            pool.release(second);
+            return result;
+        }
+
+    private:
+        template <typename Op, typename... Args>
+        const Operation& make(Args&&... args)
+        {
+            m_nodes.push_back(std::make_unique<Op>(std::forward<Args>(args)...));
+            return *m_nodes.back();
+        }
+
+        const Operation& power(const Operation& base, int exponent)
+        {
+            m_powers = true;
+            return make<Pow>(base, exponent);
+        }
+
+        const Operation& factored(const Operation& base)
+        {
+            m_factors = true;
+            if (next(2) == 0)
+                return make<Det>(base);
+            return make<Inverse>(base);
+        }
+
+        const Operation& solve(const Operation& first, const Operation& second)
+        {
+            m_factors = true;
+            return make<Solve>(first, second);
+        }
+
+        const Operation& leaf()
+        {
+            switch (next(3))
+            {
+            case 0: return make<Identity>();
+            case 1: return make<Transpose>();
+            default: return make<Scalar>(next(7) - 3);
+            }
+        }
+
+        const Operation& binary(const Operation& first, const Operation& second)
+        {
+            switch (next(4))
+            {
+            case 0: return make<Add>(first, second);
+            case 1: return make<Sub>(first, second);
+            case 2: return make<Mul>(first, second);
+            default: return make<Comp>(first, second);
+            }
+        }
+
+        std::mt19937 m_random;
+        std::vector<std::unique_ptr<Operation>> m_nodes;
+        bool m_powers = false;
+        bool m_factors = false;
+    };
+
+    // the printed result, or the message of the error
+    template <typename F>
+    std::string outcome(F&& f)
+    {
+        try
+        {
+            auto ostr = std::ostringstream();
+            ostr << f();
+            return ostr.str();
+        }
+        catch (const std::exception& e)
+        {
+            return std::string("error: ") + e.what();
+        }
+    }
+
+    // the matrices of input with the element type E
+    template <typename E>
+    std::vector<SquareMatrix<E>> convert(const std::vector<SquareMatrix<int>>& input)
+    {
+        auto result = std::vector<SquareMatrix<E>>();
+        for (const auto& matrix : input)
+        {
+            auto converted = SquareMatrix<E>(matrix.size(), E());
+            std::copy(matrix.data(), matrix.data() + matrix.count(), converted.data());
+            result.push_back(std::move(converted));
+        }
+        return result;
+    }
+
+    // An integral matrix with an integral inverse: row operations row(i) +=
+    // c row(j) on the identity, each applied to the inverse as the column
+    // operation that undoes it, and a swap, so that det is -1. An operation
+    // that would take a value of the matrix past limit, or one of the
+    // inverse out of the window, is skipped
+    std::pair<SquareMatrix<int>, SquareMatrix<int>> invertible(Generator& generator, int size, int limit)
+    {
+        auto matrix = SquareMatrix<int>(size, 0);
+        auto inverse = SquareMatrix<int>(size, 0);
+        for (int i = 0; i < size; ++i)
+            matrix(i, i) = inverse(i, i) = 1;
+        for (int step = 0; step < 4 * size; ++step)
+        {
+            const int i = generator.next(size);
+            const int j = generator.next(size);
+            const int c = generator.next(2) == 0 ? -1 : 1;
+            bool fits = i != j;
+            for (int k = 0; k < size && fits; ++k)
+                fits = std::abs(matrix(i, k) + c * matrix(j, k)) <= limit && isInRange(inverse(k, j) - c * inverse(k, i));
+            if (!fits)
+                continue;
+            for (int k = 0; k < size; ++k)
+            {
+                matrix(i, k) += c * matrix(j, k);
+                inverse(k, j) -= c * inverse(k, i);
+            }
+        }
+        std::swap_ranges(matrix.row(0), matrix.row(0) + size, matrix.row(1));
+        for (int k = 0; k < size; ++k)
+            std::swap(inverse(k, 0), inverse(k, 1));
+        return { std::move(matrix), std::move(inverse) };
+    }
+
+    // The exact factorization of int matrices, blocked and not, at sizes up
+    // to past two blocks: its intermediate values go far past 64 bits
+    int checkExactLu(Generator& generator)
+    {
+        int failures = 0;
+        const auto check = [&](const char* what, const std::string& result, const std::string& expected) {
+            if (result != expected && ++failures <= 5)
+                std::cout << what << ":\n" << expected << "\nexact LU:\n" << result << "\n";
+        };
+        for (const int size : { 20, 40, 64 })
+        {
+            for (const int block : { LU_BLOCK, size })
+            {
+                // the last row a copy of the first
+                auto singular = generator.matrix(size, 9);
+                std::copy(singular.row(0), singular.row(0) + size, singular.row(size - 1));
+                const auto zero = SquareMatrix<int>(size, 0);
+                const auto lu = LuFactorization<int>(singular, block);
+                check("det of a singular matrix", outcome([&] { return lu.determinant(); }), outcome([&] { return zero; }));
+                check("inverse of a singular matrix", outcome([&] { return lu.inverse(); }), "error: the matrix is singular");
+
+                // A X for X in [-1, 1] stays in the window
+                const auto pair = invertible(generator, size, 12);
+                const auto factors = LuFactorization<int>(pair.first, block);
+                auto det = SquareMatrix<int>(size, 0);
+                for (int i = 0; i < size; ++i)
+                    det(i, i) = -1;
+                const auto x = generator.matrix(size, 1);
+                check("det", outcome([&] { return factors.determinant(); }), outcome([&] { return det; }));
+                check("inverse", outcome([&] { return factors.inverse(); }), outcome([&] { return pair.second; }));
+                check("solve", outcome([&] { return factors.solve(pair.first * x); }), outcome([&] { return x; }));
+            }
+        }
+
+        // the exact det out of the window, and the first value of the
+        // inverse in lowest terms
+        auto twos = SquareMatrix<int>(41, 0);
+        for (int i = 0; i < twos.size(); ++i)
+            twos(i, i) = -2;
+        const auto lu = LuFactorization<int>(twos);
+        check("det out of the window", outcome([&] { return lu.determinant(); }), "error: the value: -2199023255552 ,is invalid value");
+        check("inverse out of the window", outcome([&] { return lu.inverse(); }), "error: the value: -1/2 ,is invalid value");
+        return failures;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    auto generator = Generator(12345);
+    auto sharedCache = EvalCache(16);
+    auto threads = ThreadPool(4);
+    int failures = 0;
+
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        const auto& operation = generator.next(2) == 0 ? generator.tree(1 + generator.next(4))
+                                                       : generator.shared(2 + generator.next(6));
+        if (operation.inputCount() > 48)
+        {
+            generator.clear();
+            continue;
+        }
+
+        // the large inputs stay small, so that their products stay in range;
+        // half of them are mostly zeros, so that programs with a product run
+        // them in CSR form
+        const int size = generator.size();
+        const bool sparse = size >= SPARSE_MIN_SIZE && generator.next(2) == 0;
+        auto input = std::vector<SquareMatrix<int>>();
+        for (int i = 0; i < operation.inputCount(); ++i)
+            input.push_back(sparse ? generator.sparse(size) : generator.matrix(size, size > 5 ? 1 : 4));
+
+        const auto expected = outcome([&] { return operation.compute(input); });
+        auto evalCache = EvalCache();
+        const auto& program = operation.program();
+        auto results = std::vector<std::string>{
+            outcome([&] { return program.run<int>(input); }),
+            outcome([&] { return program.run<int>(input, &evalCache); }),
+            outcome([&] { return program.run<int>(input, &sharedCache); }),
+            outcome([&] { return program.run<int>(input, &sharedCache); }),
+            // the large inputs make the branches of Add, Sub and Mul fork
+            outcome([&] { return program.run<int>(input, nullptr, &threads); }),
+            outcome([&] { return program.run<int>(input, &evalCache, &threads); }),
+            // the integers of the window are exact in every element type
+            outcome([&] { return program.run<std::int64_t>(convert<std::int64_t>(input), &sharedCache); }),
+        };
+        // but a floating point power is range checked only on its result
+        // (see MatrixPower.h), so where an integral one fails on a square
+        // it may not; and only the integral factorizations are exact
+        if (!generator.factors() && (!generator.powers() || expected.rfind("error: ", 0) != 0))
+        {
+            results.push_back(outcome([&] { return program.run<float>(convert<float>(input)); }));
+            results.push_back(outcome([&] { return program.run<double>(convert<double>(input), &evalCache); }));
+        }
+        for (const auto& result : results)
+        {
+            if (result == expected)
+                continue;
+            if (++failures <= 5)
+            {
+                operation.print(std::cout, true);
+                std::cout << "\ncompute:\n" << expected << "\nprogram:\n" << result << "\n";
+            }
+            break;
+        }
+        generator.clear();
+    }
+
+    // the same through an interning OperationPool: up to 8 trees live at a
+    // time, so the slots of the released ones are reused by the next
+    auto pool = OperationPool(true);
+    auto live = std::vector<OperationHandle>();
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        live.push_back(generator.pooled(pool, 1 + generator.next(4)));
+        const auto& operation = pool[live.back()];
+        const int size = 1 + generator.next(5);
+        auto input = std::vector<SquareMatrix<int>>();
+        for (int i = 0; i < operation.inputCount(); ++i)
+            input.push_back(generator.matrix(size, 4));
+
+        const auto expected = outcome([&] { return operation.compute(input); });
+        const auto result = outcome([&] { return operation.program().run<int>(input, &sharedCache); });
+        if (result != expected && ++failures <= 5)
+        {
+            operation.print(std::cout, true);
+            std::cout << "\ncompute:\n" << expected << "\npooled program:\n" << result << "\n";
+        }
+        if (live.size() == 8)
+        {
+            const auto index = static_cast<std::size_t>(generator.next(8));
+            pool.release(live[index]);
+            live.erase(live.begin() + static_cast<std::ptrdiff_t>(index));
+        }
+    }
+    for (const auto handle : live)
+        pool.release(handle);
+    if (pool.size() != 0)
+    {
+        ++failures;
+        std::cout << pool.size() << " nodes of the pool were not freed\n";
+    }
+
+    failures += checkExactLu(generator);
+
+    std::cout << failures << " mismatches in " << iterations << " trees\n";
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}